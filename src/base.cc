@@ -4,4 +4,6 @@
 
 Event::~Event() {}
 
+Executor::~Executor() {}
+
 Actor::~Actor() {}
@@ -3,20 +3,61 @@
 #ifndef SRC_BASE_H_
 #define SRC_BASE_H_
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 
+namespace journal {
+class Encoder;
+}  // namespace journal
+
+// Lanes the spool queues events in, most urgent first
+enum class Priority : uint8_t {
+  // Actor lifecycle and shutdown, which should not wait behind a backlog
+  kControl,
+  kNormal,
+  // Large or frequent updates, which can wait, though each still gets a
+  // share of the workers while control and normal events are backlogged
+  kBulk,
+};
+
 class Event {
  public:
   virtual ~Event();
   // English language description of the event.
   virtual std::string Description() = 0;
+  // Lane the event is queued in
+  virtual Priority Lane() const { return Priority::kNormal; }
+  // Key of the latest-value state the event updates, or 0. A queued event
+  // with the same key for the same actor is replaced by this one, in its
+  // place, so a slow actor only handles the newest.
+  virtual uint64_t Conflation() const { return 0; }
+  // Kind the event is journaled as, or 0 if it is not journaled; events are
+  // decoded by the decoder registered for their kind with journal::Register.
+  virtual uint32_t Kind() const { return 0; }
+  // Append a compact binary encoding of the event, returning false if it has
+  // none.
+  virtual bool Encode(journal::Encoder *e) const { return false; }
+};
+
+class Actor;
+
+// Has actors handle their events on a thread of its choosing, queueing them
+// until then in lanes and conflating them as the spool does
+class Executor {
+ public:
+  virtual ~Executor();
+  virtual void Post(std::shared_ptr<Actor> a, std::shared_ptr<Event> e) = 0;
 };
 
 class Actor {
  public:
   virtual ~Actor();
   virtual void Handle(std::shared_ptr<Event> const e) = 0;
+  // Executor the spool hands this actor's events to, or null to have them
+  // handled on any of its workers
+  virtual Executor *Affinity() { return nullptr; }
 };
 
 #endif  // SRC_BASE_H_
@@ -9,4 +9,18 @@ Terminate::Terminate(std::string s) : reason{s} {}
 Destroy::Destroy(std::shared_ptr<class Actor> a) : actor{a} {}
 Spawn::Spawn(std::shared_ptr<class Actor> a) : actor{a} {}
 
+bool Terminate::Encode(journal::Encoder *e) const {
+  e->Put(reason);
+  return true;
+}
+
+namespace {
+
+const bool registered = journal::Register(
+    journal::Tag("events::Terminate"), [](journal::Decoder *d) {
+      return std::shared_ptr<Event>{new Terminate{d->String()}};
+    });
+
+}  // namespace
+
 }  // namespace events
@@ -7,6 +7,7 @@
 #include <string>
 
 #include "src/base.h"
+#include "src/journal.h"
 #include "src/util.h"
 
 // TODO(cptaffe): make events abstract classes for extending
@@ -17,6 +18,9 @@ class Terminate : public Event {
  public:
   explicit Terminate(std::string reason);
   std::string Description() override { return "Terminating: " + reason; }
+  Priority Lane() const override { return Priority::kControl; }
+  uint32_t Kind() const override { return journal::Tag("events::Terminate"); }
+  bool Encode(journal::Encoder *e) const override;
 
  private:
   std::string reason;
@@ -39,6 +43,7 @@ class Spawn : public Event {
  public:
   explicit Spawn(std::shared_ptr<class Actor> a);
   std::string Description() override { return "Spawning an actor"; }
+  Priority Lane() const override { return Priority::kControl; }
   std::shared_ptr<class Actor> Actor() { return actor; }
 
  private:
@@ -50,6 +55,7 @@ class Destroy : public Event {
  public:
   explicit Destroy(std::shared_ptr<class Actor> a);
   std::string Description() override { return "Destroying an actor"; }
+  Priority Lane() const override { return Priority::kControl; }
   std::shared_ptr<class Actor> Actor() { return actor; }
 
  private:
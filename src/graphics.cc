@@ -5,69 +5,126 @@
 
 namespace renderables {
 
-Scale::Scale(glm::vec3 s) : scale{s} {}
+Scale::Scale(glm::vec3 s) : scale{glm::scale(s)} {}
 
-std::vector<glm::mat4> Scale::Render() const { return {glm::scale(scale)}; }
+std::vector<glm::mat4> Scale::Render(const renderer::Frame &f) const {
+  return {scale};
+}
 
 Translate::Translate(glm::vec3 t) : translation{glm::translate(t)} {}
 
-std::vector<glm::mat4> Translate::Render() const { return {translation}; }
+std::vector<glm::mat4> Translate::Render(const renderer::Frame &f) const {
+  return {translation};
+}
 
-Rotate::Rotate(double a, glm::vec3 v) : angle{a}, vec{v} {}
+Rotate::Rotate(double a, glm::vec3 v)
+    : rotation{glm::rotate(static_cast<float>(a), v)} {}
 
-std::vector<glm::mat4> Rotate::Render() const {
-  return {glm::rotate(static_cast<float>(angle), vec)};
+std::vector<glm::mat4> Rotate::Render(const renderer::Frame &f) const {
+  return {rotation};
 }
 
 Float::Float(double rad, std::chrono::duration<double> d)
-    : radius{rad}, duration{d} {}
-
-std::vector<glm::mat4> Float::Render() const {
-  return Translate{
-      glm::vec3{0, radius * glm::cos(renderer::Timer::Instance()->Since() /
-                                     duration * 2 * glm::pi<double>()),
-                0}}
-      .Render();
+    : track{renderer::Track::Kind::kFloat, glm::vec3{0, 1, 0},
+            static_cast<float>(rad), static_cast<float>(d.count()), 0} {}
+
+std::vector<glm::mat4> Float::Render(const renderer::Frame &f) const {
+  glm::mat4 m;
+  renderer::Evaluate(&track, 1, f, &m);
+  return {m};
 }
 
-Spin::Spin(std::chrono::duration<double> d) : duration{d} {}
+Spin::Spin(std::chrono::duration<double> d)
+    : track{renderer::Track::Kind::kSpin, glm::vec3{0, 1, 0}, 0,
+            static_cast<float>(d.count()), 0} {}
 
-std::vector<glm::mat4> Spin::Render() const {
-  return Rotate{
-      renderer::Timer::Instance()->Since() / duration * 2 * glm::pi<double>(),
-      glm::vec3{0, 1, 0}}
-      .Render();
+std::vector<glm::mat4> Spin::Render(const renderer::Frame &f) const {
+  glm::mat4 m;
+  renderer::Evaluate(&track, 1, f, &m);
+  return {m};
 }
 
 MatRenderable::MatRenderable(glm::mat4 m) : matrix{m} {}
 
 }  // namespace renderables
 
-Fps::Fps() : ticks{std::chrono::high_resolution_clock::now()}, diff{0} {}
-
-void Fps::Update() {
-  auto now = std::chrono::high_resolution_clock::now();
-  diff = now - ticks;
-  ticks = now;
+namespace {
+
+// Records spawning n floating, spinning cubes of the given geometry
+std::vector<event::SpawnBatch::Record> spawnCubes(
+    std::shared_ptr<renderer::Rasterizable> cube, int n,
+    std::mt19937_64 *random) {
+  auto rand =
+      std::bind(std::uniform_real_distribution<double>(-1, 1), *random);
+  // Every cube's model is the same chain of stages, so its translation and
+  // scale are folded together once, leaving only its animation per frame
+  using Model =
+      renderer::TransformChain<renderables::Translate, renderables::Scale,
+                               renderables::Float, renderables::Spin>;
+  std::vector<event::SpawnBatch::Record> records;
+  records.reserve(n);
+  for (auto i = 0; i < n; i++) {
+    records.push_back(
+        {cube, std::shared_ptr<renderer::Renderable>(new Model(
+                   renderables::Translate({rand(), rand(), rand()}),
+                   renderables::Scale({0.25, 0.25, 0.25}),
+                   renderables::Float(
+                       0.25, std::chrono::milliseconds(
+                                 std::uniform_int_distribution<uint64_t>(
+                                     1000, 5000)(*random))),
+                   renderables::Spin(std::chrono::milliseconds(
+                       std::uniform_int_distribution<uint64_t>(1000, 6000)(
+                           *random)))))});
+  }
+  return records;
 }
 
-double Fps::Frame() const {
-  return 1.0 /
-         std::chrono::duration_cast<std::chrono::duration<double>>(diff)
-             .count();
+double milliseconds(std::chrono::steady_clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
 }
 
-std::ostream &operator<<(std::ostream &o, const Fps &fps) {
-  return o << fps.Frame();
-}
+}  // namespace
 
 int main(int argc, const char *argv[]) {
-  if (argc != 3) {
-    throw std::runtime_error("./graphics cubes windows");
+  if (argc == 4 && std::string(argv[1]) == "dump") {
+    // Write the cubes a run would spawn to a scene file, timing that
+    // against loading it back
+    int cubes;
+    std::stringstream(argv[3]) >> cubes;
+    std::mt19937_64 random;
+    auto start = std::chrono::steady_clock::now();
+    auto records =
+        spawnCubes(renderer::shapes::CubeGeometry(), cubes, &random);
+    auto generated = std::chrono::steady_clock::now();
+    renderer::SceneFile::Write(argv[2], records);
+    auto written = std::chrono::steady_clock::now();
+    auto loaded = renderer::SceneFile::Open(argv[2])->Records();
+    auto read = std::chrono::steady_clock::now();
+    std::cout << "generated " << records.size() << " cubes in "
+              << milliseconds(generated - start) << "ms, wrote them in "
+              << milliseconds(written - generated) << "ms, loaded "
+              << loaded.size() << " in " << milliseconds(read - written)
+              << "ms" << std::endl;
+    return 0;
+  }
+  if (argc < 3 || argc > 5) {
+    throw std::runtime_error(
+        "./graphics (cubes|scene) windows [headless frames [soft]]\n"
+        "./graphics dump scene cubes");
+  }
+  int cubes = 0, windows;
+  uint64_t frames = 0;
+  // Either a number of cubes or a scene file to load
+  std::shared_ptr<renderer::SceneFile> scene;
+  if (!(std::stringstream(argv[1]) >> cubes)) {
+    scene = renderer::SceneFile::Open(argv[1]);
+    cubes = scene->Instances();
   }
-  int cubes, windows;
-  std::stringstream(argv[1]) >> cubes;
   std::stringstream(argv[2]) >> windows;
+  if (argc >= 4) {
+    std::stringstream(argv[3]) >> frames;
+  }
+  auto soft = argc == 5 && std::string(argv[4]) == "soft";
 
   std::cout << "spawning " << windows << " windows with " << cubes << " cubes"
             << std::endl;
@@ -77,49 +134,57 @@ int main(int argc, const char *argv[]) {
       new events::Spawn{std::shared_ptr<Actor>{new actors::Sayer{}}}});
   s->Run();  // run spool
 
-  auto renderers = std::vector<std::shared_ptr<renderer::Renderer>>();
+  // One renderer draws the scene from every window's camera
   std::mt19937_64 random;
   auto camrand =
       std::bind(std::uniform_real_distribution<double>(-4, 4), random);
+  auto builder = renderer::Builder().Projection([](size_t w, size_t h) {
+    return std::shared_ptr<renderer::Renderable>(
+        new renderables::MatRenderable(glm::perspective(
+            0.5 * glm::pi<double>(),
+            static_cast<double>(w) /
+                static_cast<double>(h),  // should be window ratio
+            0.1, 100.0)));
+  });
   for (auto i = 0; i < windows; i++) {
-    const auto renderer =
-        renderer::Builder()
-            .View(std::shared_ptr<renderer::Renderable>(
-                new renderables::MatRenderable(
-                    glm::lookAt(glm::vec3(camrand(), camrand(), camrand()),
-                                glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)))))
-            .Projection([](size_t w, size_t h) {
-              return std::shared_ptr<renderer::Renderable>(
-                  new renderables::MatRenderable(glm::perspective(
-                      0.5 * glm::pi<double>(),
-                      static_cast<double>(w) /
-                          static_cast<double>(h),  // should be window ratio
-                      0.1,
-                      100.0)));
-            })
-            .Build();
-    renderers.push_back(renderer);
-    s->Handle(std::shared_ptr<Event>{
-        new events::Spawn{std::shared_ptr<Actor>{renderer}}});
+    builder.View(std::shared_ptr<renderer::Renderable>(
+        new renderables::MatRenderable(
+            glm::lookAt(glm::vec3(camrand(), camrand(), camrand()),
+                        glm::vec3(0, 0, 0), glm::vec3(0, 1, 0)))));
   }
+  // Windows are drawn once per display refresh rather than spinning
+  builder.Pacing(renderer::Schedule::Vsync());
+  if (frames != 0) {
+    // Render offscreen, writing each view's frames out as images
+    // at a fixed step, so runs are reproducible
+    builder.Headless(400, 400).Frames(frames).Step(
+        std::chrono::duration<double>{1.0 / 60});
+    if (soft) {
+      // Rasterize on the CPU, needing no GPU or display
+      builder.Software();
+    }
+  }
+  const auto renderer = builder.Build();
+  s->Handle(std::shared_ptr<Event>{
+      new events::Spawn{std::shared_ptr<Actor>{renderer}}});
 
-  auto rand = std::bind(std::uniform_real_distribution<double>(-1, 1), random);
-  for (auto i = 0; i < cubes; i++) {
-    s->Handle(std::unique_ptr<Event>(new event::Spawn(
-        renderers[0]->ShapeFactory()->Cube(),
-        std::vector<std::shared_ptr<renderer::Renderable>>(
-            {std::shared_ptr<renderer::Renderable>(
-                 new renderables::Translate({rand(), rand(), rand()})),
-             std::shared_ptr<renderer::Renderable>(
-                 new renderables::Scale({0.25, 0.25, 0.25})),
-             std::shared_ptr<renderer::Renderable>(new renderables::Float(
-                 0.25, std::chrono::milliseconds(
-                           std::uniform_int_distribution<uint64_t>(
-                               1000, 5000)(random)))),
-             std::shared_ptr<renderer::Renderable>(
-                 new renderables::Spin(std::chrono::milliseconds(
-                     std::uniform_int_distribution<uint64_t>(
-                         1000, 6000)(random))))}))));
+  // Record the run's events, or replay a recorded run's instead of spawning
+  if (auto path = std::getenv("ACTOR_JOURNAL")) {
+    s->Journal(journal::Journal::Create(path));
+  }
+  if (auto path = std::getenv("ACTOR_REPLAY")) {
+    // At the recorded pace unless sped up, or as fast as possible if 0
+    double speed = 1;
+    if (auto sp = std::getenv("ACTOR_REPLAY_SPEED")) {
+      std::stringstream(sp) >> speed;
+    }
+    journal::Replay(path, s, speed);
+  } else {
+    // Cubes are spawned in one batch, appended to the scene at once
+    s->Handle(std::shared_ptr<Event>(new event::SpawnBatch(
+        scene != nullptr
+            ? scene->Records()
+            : spawnCubes(renderer->ShapeFactory()->Cube(), cubes, &random))));
   }
 
   s->Wait();
@@ -9,31 +9,48 @@
 #include <glm/gtx/transform.hpp>
 
 #include <chrono>
+#include <cstdlib>
 #include <functional>
 #include <random>
 #include <sstream>
+#include <utility>
 #include <vector>
 
 #include "src/actor.h"
 #include "src/events.h"
+#include "src/journal.h"
 #include "src/renderer/builder.h"
+#include "src/renderer/chain.h"
 #include "src/renderer/renderer.h"
+#include "src/renderer/scenefile.h"
 
 namespace renderables {
 
 class Scale : public renderer::Renderable {
  public:
+  static constexpr bool kConstant = true;
+
   explicit Scale(glm::vec3 s);
-  std::vector<glm::mat4> Render() const override;
+  std::vector<glm::mat4> Render(const renderer::Frame &f) const override;
+  bool Flattened(renderer::FlatView *v) const override {
+    *v = renderer::FlatView::Of(&scale);
+    return true;
+  }
 
  private:
-  glm::vec3 scale;
+  glm::mat4 scale;
 };
 
 class Translate : public renderer::Renderable {
  public:
+  static constexpr bool kConstant = true;
+
   explicit Translate(glm::vec3 t);
-  std::vector<glm::mat4> Render() const override;
+  std::vector<glm::mat4> Render(const renderer::Frame &f) const override;
+  bool Flattened(renderer::FlatView *v) const override {
+    *v = renderer::FlatView::Of(&translation);
+    return true;
+  }
 
  private:
   glm::mat4 translation;
@@ -41,37 +58,61 @@ class Translate : public renderer::Renderable {
 
 class Rotate : public renderer::Renderable {
  public:
+  static constexpr bool kConstant = true;
+
   Rotate(double a, glm::vec3 v);
-  std::vector<glm::mat4> Render() const override;
+  std::vector<glm::mat4> Render(const renderer::Frame &f) const override;
+  bool Flattened(renderer::FlatView *v) const override {
+    *v = renderer::FlatView::Of(&rotation);
+    return true;
+  }
 
  private:
-  double angle;
-  glm::vec3 vec;
+  glm::mat4 rotation;
 };
 
 class Float : public renderer::Renderable {
  public:
+  static constexpr bool kConstant = false;
+
   Float(double rad, std::chrono::duration<double> d);
-  std::vector<glm::mat4> Render() const override;
+  std::vector<glm::mat4> Render(const renderer::Frame &f) const override;
+  bool Flattened(renderer::FlatView *v) const override {
+    *v = renderer::FlatView::Of(&track);
+    return true;
+  }
 
  private:
-  double radius;
-  std::chrono::duration<double> duration;
+  renderer::Track track;
 };
 
 class Spin : public renderer::Renderable {
  public:
+  static constexpr bool kConstant = false;
+
   explicit Spin(std::chrono::duration<double> d);
-  std::vector<glm::mat4> Render() const override;
+  std::vector<glm::mat4> Render(const renderer::Frame &f) const override;
+  bool Flattened(renderer::FlatView *v) const override {
+    *v = renderer::FlatView::Of(&track);
+    return true;
+  }
 
  private:
-  std::chrono::duration<double> duration;
+  renderer::Track track;
 };
 
 class MatRenderable : public renderer::Renderable {
  public:
+  static constexpr bool kConstant = true;
+
   explicit MatRenderable(glm::mat4 m);
-  std::vector<glm::mat4> Render() const override { return {matrix}; }
+  std::vector<glm::mat4> Render(const renderer::Frame &f) const override {
+    return {matrix};
+  }
+  bool Flattened(renderer::FlatView *v) const override {
+    *v = renderer::FlatView::Of(&matrix);
+    return true;
+  }
 
  private:
   glm::mat4 matrix;
@@ -79,18 +120,4 @@ class MatRenderable : public renderer::Renderable {
 
 }  // namespace renderables
 
-class Fps {
- public:
-  Fps();
-  friend std::ostream &operator<<(const Fps &fps, std::ostream &o);
-  void Update();
-  double Frame() const;
-
- private:
-  std::chrono::time_point<std::chrono::high_resolution_clock> ticks;
-  std::chrono::duration<double> diff;
-};
-
-std::ostream &operator<<(std::ostream &o, const Fps &fps);
-
 #endif  // SRC_GRAPHICS_H_
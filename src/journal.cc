@@ -0,0 +1,214 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/journal.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace journal {
+
+namespace {
+
+const char kMagic[8] = {'A', 'C', 'T', 'J', 'R', 'N', 'L', '1'};
+const size_t kInitial = 1 << 20;
+
+// Precedes each record's encoding, which is padded to a multiple of 8 bytes.
+// A zeroed header, as left past the end of a journal that was not closed,
+// ends the journal.
+struct Header {
+  uint64_t time;
+  uint32_t kind, size;
+};
+
+size_t padded(size_t n) { return (n + 7) / 8 * 8; }
+
+// Read-only mapping of a whole file
+struct Mapping {
+  explicit Mapping(const std::string &path) {
+    auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("journal::Replay: cannot open " + path);
+    }
+    struct stat st;
+    auto d = fstat(fd, &st) == 0 && st.st_size > 0
+                 ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)
+                 : MAP_FAILED;
+    close(fd);
+    if (d == MAP_FAILED) {
+      throw std::runtime_error("journal::Replay: cannot map " + path);
+    }
+    data = static_cast<const char *>(d);
+    size = st.st_size;
+  }
+  Mapping(const Mapping &) = delete;
+  ~Mapping() { munmap(const_cast<char *>(data), size); }
+
+  const char *data;
+  size_t size;
+};
+
+std::map<uint32_t, Decode> &decoders() {
+  static std::map<uint32_t, Decode> d;
+  return d;
+}
+
+std::vector<std::function<void(uint32_t)>> &ends() {
+  static std::vector<std::function<void(uint32_t)>> e;
+  return e;
+}
+
+// Handle each event of a mapped journal at its recorded time, scaled by
+// speed, stopping at the first truncated record
+void replay(const Mapping &m, uint32_t origin, Actor *target, double speed) {
+  auto start = std::chrono::steady_clock::now();
+  for (auto offset = sizeof(kMagic); m.size - offset >= sizeof(Header);) {
+    Header h;
+    std::memcpy(&h, m.data + offset, sizeof(h));
+    offset += sizeof(h);
+    if (h.kind == 0 || h.size > m.size - offset) {
+      return;
+    }
+    Decoder decoder{m.data + offset, h.size, origin};
+    auto e = Reconstruct(h.kind, &decoder);
+    offset += std::min<size_t>(padded(h.size), m.size - offset);
+    if (speed != 0) {
+      std::this_thread::sleep_until(
+          start +
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::nanoseconds(h.time) / speed));
+    }
+    target->Handle(e);
+  }
+}
+
+}  // namespace
+
+bool Register(uint32_t kind, Decode d) {
+  decoders()[kind] = d;
+  return true;
+}
+
+uint32_t NewOrigin() {
+  static std::atomic<uint32_t> origins{0};
+  return ++origins;
+}
+
+std::shared_ptr<Event> Reconstruct(uint32_t kind, Decoder *d) {
+  auto decode = decoders().find(kind);
+  if (decode == decoders().end()) {
+    throw std::runtime_error("journal: no decoder for kind " +
+                             std::to_string(kind));
+  }
+  return decode->second(d);
+}
+
+bool RegisterEnd(std::function<void(uint32_t origin)> f) {
+  ends().push_back(f);
+  return true;
+}
+
+void End(uint32_t origin) {
+  for (auto &f : ends()) {
+    f(origin);
+  }
+}
+
+std::shared_ptr<Journal> Journal::Create(const std::string &path) {
+  auto fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("journal::Journal: cannot open " + path);
+  }
+  return std::shared_ptr<Journal>{new Journal{fd, path}};
+}
+
+Journal::Journal(int f, std::string p)
+    : fd{f}, path{p}, length{sizeof(kMagic)},
+      start{std::chrono::steady_clock::now()} {
+  Reserve(kInitial);
+  std::memcpy(data, kMagic, sizeof(kMagic));
+}
+
+Journal::~Journal() {
+  munmap(data, capacity);
+  // Trim the unused tail of the mapping
+  if (ftruncate(fd, length) != 0) {
+    std::cerr << "journal::Journal: cannot truncate " << path << std::endl;
+  }
+  close(fd);
+}
+
+void Journal::Reserve(size_t n) {
+  if (n <= capacity) {
+    return;
+  }
+  auto c = std::max(n, 2 * capacity);
+  if (data != nullptr) {
+    munmap(data, capacity);
+  }
+  auto d = ftruncate(fd, c) == 0
+               ? mmap(nullptr, c, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+               : MAP_FAILED;
+  if (d == MAP_FAILED) {
+    throw std::runtime_error("journal::Journal: cannot map " + path);
+  }
+  data = static_cast<char *>(d);
+  capacity = c;
+}
+
+void Journal::Record(const Event &e) {
+  auto kind = e.Kind();
+  if (kind == 0) {
+    return;
+  }
+  // Encoded outside the lock into a buffer kept per thread
+  thread_local Encoder encoder;
+  encoder.Clear();
+  if (!e.Encode(&encoder)) {
+    return;
+  }
+  auto &bytes = encoder.Bytes();
+  if (bytes.size() > UINT32_MAX) {
+    throw std::runtime_error("journal::Journal: event too large");
+  }
+  Header h{
+      static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count()),
+      kind, static_cast<uint32_t>(bytes.size())};
+  auto n = sizeof(h) + padded(bytes.size());
+  std::unique_lock<std::mutex> lock(mutex);
+  Reserve(length + n);
+  std::memcpy(data + length, &h, sizeof(h));
+  std::memcpy(data + length + sizeof(h), bytes.data(), bytes.size());
+  length += n;
+}
+
+void Replay(const std::string &path, Actor *target, double speed) {
+  Mapping m{path};
+  if (m.size < sizeof(kMagic) ||
+      std::memcmp(m.data, kMagic, sizeof(kMagic)) != 0) {
+    throw std::runtime_error("journal::Replay: not a journal " + path);
+  }
+  auto origin = NewOrigin();
+  try {
+    replay(m, origin, target, speed);
+  } catch (...) {
+    End(origin);
+    throw;
+  }
+  End(origin);
+}
+
+}  // namespace journal
+
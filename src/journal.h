@@ -0,0 +1,158 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_JOURNAL_H_
+#define SRC_JOURNAL_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "src/base.h"
+
+// Recording of the events handled by a spool, so a workload can be
+// replayed identically for benchmarking and profiling.
+namespace journal {
+
+// Kind of an event from its name, e.g. Tag("events::Terminate")
+constexpr uint32_t Tag(const char *name) {
+  uint32_t h = 2166136261u;
+  for (; *name != '\0'; name++) {
+    h = (h ^ static_cast<uint8_t>(*name)) * 16777619u;
+  }
+  return h;
+}
+
+// Appends values in their native representation
+class Encoder {
+ public:
+  template <typename T>
+  void Put(const T &t) {
+    Put(&t, 1);
+  }
+  template <typename T>
+  void Put(const T *t, size_t n) {
+    static_assert(std::is_trivially_copyable<T>::value, "not encodable");
+    bytes.append(reinterpret_cast<const char *>(t), n * sizeof(T));
+  }
+  void Put(const std::string &s) {
+    Put<uint64_t>(s.size());
+    bytes.append(s);
+  }
+
+  const std::string &Bytes() const { return bytes; }
+  void Clear() { bytes.clear(); }
+
+ private:
+  std::string bytes;
+};
+
+// Reads values written by an Encoder, throwing if they run past its end
+class Decoder {
+ public:
+  // Decoder of n bytes encoded by an origin, from NewOrigin, or 0 if this
+  // process encoded them
+  Decoder(const char *d, size_t n, uint32_t o = 0)
+      : data{d}, size{n}, origin{o} {}
+
+  // Names events give, e.g. spawned objects' handles, are the origin's
+  // rather than this process'
+  uint32_t Origin() const { return origin; }
+
+  template <typename T>
+  T Get() {
+    T t;
+    Get(&t, 1);
+    return t;
+  }
+  template <typename T>
+  void Get(T *t, size_t n) {
+    static_assert(std::is_trivially_copyable<T>::value, "not decodable");
+    if (n > (size - offset) / sizeof(T)) {
+      throw std::runtime_error("journal::Decoder: truncated event");
+    }
+    std::memcpy(t, data + offset, n * sizeof(T));
+    offset += n * sizeof(T);
+  }
+  // n values, checked against the bytes left before allocating
+  template <typename T>
+  std::vector<T> Array(uint64_t n) {
+    if (n > Remaining() / sizeof(T)) {
+      throw std::runtime_error("journal::Decoder: truncated event");
+    }
+    std::vector<T> v(n);
+    Get(v.data(), n);
+    return v;
+  }
+  std::string String() {
+    auto n = Get<uint64_t>();
+    if (n > size - offset) {
+      throw std::runtime_error("journal::Decoder: truncated event");
+    }
+    offset += n;
+    return std::string(data + offset - n, n);
+  }
+  size_t Remaining() const { return size - offset; }
+
+ private:
+  const char *data;
+  size_t size, offset = 0;
+  uint32_t origin;
+};
+
+// Number naming a source of decoded events, e.g. a journal being replayed
+// or a channel from another process, unique within this process
+uint32_t NewOrigin();
+
+using Decode = std::function<std::shared_ptr<Event>(Decoder *d)>;
+
+// Register the decoder of a kind of event, returning true so it can
+// initialize a static
+bool Register(uint32_t kind, Decode d);
+// Decode an event of a kind, throwing if no decoder is registered for it
+std::shared_ptr<Event> Reconstruct(uint32_t kind, Decoder *d);
+
+// Register a function called with each origin that ends, e.g. to drop names
+// decoded from it, returning true so it can initialize a static
+bool RegisterEnd(std::function<void(uint32_t origin)> f);
+// Tell every registered function an origin will decode no more events
+void End(uint32_t origin);
+
+// Append-only log of events, memory mapped so recording one is a copy
+// into the mapping. Each record is its time since the journal was created,
+// its kind and its encoding.
+class Journal {
+ public:
+  static std::shared_ptr<Journal> Create(const std::string &path);
+  Journal(const Journal &) = delete;
+  ~Journal();
+
+  // Append e if it is journaled, safe to call concurrently
+  void Record(const Event &e);
+
+ private:
+  Journal(int f, std::string p);
+  // Map at least n bytes, with the mutex held
+  void Reserve(size_t n);
+
+  std::mutex mutex;
+  int fd;
+  std::string path;
+  char *data = nullptr;
+  size_t capacity = 0, length;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Handle every event of a journal with target at its recorded time divided
+// by speed, or as fast as possible if speed is 0
+void Replay(const std::string &path, Actor *target, double speed = 1);
+
+}  // namespace journal
+
+#endif  // SRC_JOURNAL_H_
@@ -0,0 +1,206 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/animation.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "src/renderer/renderer.h"
+
+namespace renderer {
+
+namespace {
+
+// The constant matrices either side of a lone track
+const glm::mat4 kAroundTrack[2] = {glm::mat4(1.0), glm::mat4(1.0)};
+
+// Track's angle at time t, reduced to [-pi, pi] in double precision so
+// long runs keep the float sine accurate
+float Angle(const Track &track, double t) {
+  auto cycles = t / track.period + track.phase;
+  cycles -= std::floor(cycles);
+  if (cycles > 0.5) {
+    cycles -= 1;
+  }
+  return static_cast<float>(cycles * 2 * glm::pi<double>());
+}
+
+glm::mat4 Matrix(const Track &track, float c, float s) {
+  glm::mat4 m(1.0);
+  const auto &a = track.axis;
+  switch (track.kind) {
+    case Track::Kind::kFloat:
+      m[3] = glm::vec4(a * (track.amplitude * c), 1);
+      break;
+    case Track::Kind::kSpin: {
+      auto t = a * (1 - c);
+      m[0] = glm::vec4(c + t.x * a.x, t.x * a.y + s * a.z, t.x * a.z - s * a.y,
+                       0);
+      m[1] = glm::vec4(t.y * a.x - s * a.z, c + t.y * a.y, t.y * a.z + s * a.x,
+                       0);
+      m[2] = glm::vec4(t.z * a.x + s * a.y, t.z * a.y - s * a.x, c + t.z * a.z,
+                       0);
+      break;
+    }
+  }
+  return m;
+}
+
+}  // namespace
+
+void Evaluate(const Track *tracks, size_t n, const Frame &f, glm::mat4 *out) {
+  auto t = f.time.count();
+  size_t i = 0;
+#ifdef __SSE__
+  // Angles are reflected from beyond +-pi/2 into it, flipping the cosine,
+  // where the sine and cosine Taylor series are accurate to within 4e-6.
+  auto sign = _mm_set1_ps(-0.0f), one = _mm_set1_ps(1.0f);
+  auto pi = _mm_set1_ps(glm::pi<float>()),
+       half = _mm_set1_ps(glm::half_pi<float>());
+  for (; i + 4 <= n; i += 4) {
+    alignas(16) float c[4], s[4];
+    auto x = _mm_setr_ps(Angle(tracks[i], t), Angle(tracks[i + 1], t),
+                         Angle(tracks[i + 2], t), Angle(tracks[i + 3], t));
+    auto over = _mm_cmpgt_ps(_mm_andnot_ps(sign, x), half);
+    auto reflected = _mm_sub_ps(_mm_or_ps(_mm_and_ps(sign, x), pi), x);
+    x = _mm_or_ps(_mm_and_ps(over, reflected), _mm_andnot_ps(over, x));
+    auto x2 = _mm_mul_ps(x, x);
+    auto polynomial = [&](std::initializer_list<float> k) {
+      auto p = _mm_setzero_ps();
+      for (auto j = k.end(); j != k.begin();) {
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(*--j));
+      }
+      return p;
+    };
+    auto sine = _mm_mul_ps(x, polynomial({1.0f, -1.0f / 6, 1.0f / 120,
+                                          -1.0f / 5040, 1.0f / 362880}));
+    auto cosine = polynomial({1.0f, -1.0f / 2, 1.0f / 24, -1.0f / 720,
+                              1.0f / 40320, -1.0f / 3628800});
+    cosine = _mm_xor_ps(cosine, _mm_and_ps(over, sign));
+    // Keep the series' overshoot from leaving the unit interval
+    _mm_store_ps(s, _mm_max_ps(_mm_min_ps(sine, one), _mm_xor_ps(one, sign)));
+    _mm_store_ps(c,
+                 _mm_max_ps(_mm_min_ps(cosine, one), _mm_xor_ps(one, sign)));
+    for (int j = 0; j < 4; j++) {
+      out[i + j] = Matrix(tracks[i + j], c[j], s[j]);
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    auto x = Angle(tracks[i], t);
+    out[i] = Matrix(tracks[i], std::cos(x), std::sin(x));
+  }
+}
+
+FlatView FlatView::Of(const Track *t) { return {kAroundTrack, t, 1}; }
+
+glm::mat4 Compose(const glm::mat4 *folded, const Track *tracks, size_t n,
+                  const Frame &f) {
+  // Tracks are evaluated a few at a time, so in one batch for most chains
+  auto m = folded[0];
+  glm::mat4 e[4];
+  for (size_t k = 0; k < n; k += 4) {
+    auto c = std::min<size_t>(4, n - k);
+    Evaluate(&tracks[k], c, f, e);
+    for (size_t j = 0; j < c; j++) {
+      m *= e[j] * folded[k + j + 1];
+    }
+  }
+  return m;
+}
+
+void Models::Clear() {
+  stages.clear();
+  objects.clear();
+  tracks.clear();
+}
+
+void Models::Add(const Renderable &model) {
+  Push(&model);
+  objects.push_back(static_cast<uint32_t>(stages.size()));
+}
+
+void Models::Add(const std::vector<std::shared_ptr<Renderable>> &model) {
+  for (auto &r : model) {
+    Push(r.get());
+  }
+  objects.push_back(static_cast<uint32_t>(stages.size()));
+}
+
+void Models::Push(const Renderable *r) {
+  FlatView v;
+  auto track = static_cast<uint32_t>(tracks.size());
+  if (r->Flattened(&v)) {
+    // Its tracks join the batch, and are composed with its constant
+    // matrices when appending
+    stages.push_back({r, v.folded, track, static_cast<uint32_t>(v.n)});
+    tracks.insert(tracks.end(), v.tracks, v.tracks + v.n);
+  } else {
+    stages.push_back({r, nullptr, track, 0});
+  }
+}
+
+template <typename V>
+void Models::Append(const Frame &f, V *out) {
+  evaluated.resize(tracks.size());
+  renderer::Evaluate(tracks.data(), tracks.size(), f, evaluated.data());
+  uint32_t begin = 0;
+  for (auto end : objects) {
+    // Compose a single matrix while every stage has one
+    glm::mat4 m(1.0), n;
+    auto i = begin;
+    for (; i < end; i++) {
+      auto &s = stages[i];
+      if (s.folded != nullptr) {
+        m *= Compose(s.folded, evaluated.data() + s.track, s.chained);
+      } else if (s.renderable->Matrix(f, &n)) {
+        m *= n;
+      } else {
+        break;
+      }
+    }
+    if (i == end) {
+      out->push_back(m);
+    } else {
+      // Renderables may render several matrices, each applied to every
+      // matrix so far
+      std::vector<glm::mat4> ms = {m}, next;
+      for (; i < end; i++) {
+        auto &s = stages[i];
+        auto rendering =
+            s.folded != nullptr
+                ? std::vector<glm::mat4>{Compose(
+                      s.folded, evaluated.data() + s.track, s.chained)}
+                : s.renderable->Render(f);
+        next.clear();
+        for (auto &a : ms) {
+          for (auto &b : rendering) {
+            next.push_back(a * b);
+          }
+        }
+        ms.swap(next);
+      }
+      out->insert(out->end(), ms.begin(), ms.end());
+    }
+    begin = end;
+  }
+}
+
+void Models::Evaluate(const Frame &f, std::vector<glm::mat4> *out) {
+  Append(f, out);
+}
+
+void Models::Evaluate(const Frame &f, std::pmr::vector<glm::mat4> *out) {
+  Append(f, out);
+}
+
+}  // namespace renderer
@@ -0,0 +1,123 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_ANIMATION_H_
+#define SRC_RENDERER_ANIMATION_H_
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "src/renderer/clock.h"
+
+namespace renderer {
+
+class Renderable;
+
+// Closed-form periodic animation as a compact parameter record
+struct Track {
+  enum class Kind : uint8_t {
+    // Translation along axis by amplitude times the cycle's cosine
+    kFloat,
+    // One rotation about the unit axis per cycle, ignoring amplitude
+    kSpin
+  };
+
+  Kind kind;
+  glm::vec3 axis;
+  float amplitude;
+  // Seconds per cycle, and the fraction of a cycle it starts at
+  float period, phase;
+};
+
+// Write the matrices of n tracks at frame f into out, computing their sines
+// and cosines four at a time where SIMD is available
+void Evaluate(const Track *tracks, size_t n, const Frame &f, glm::mat4 *out);
+
+// A flattened transform in place, n tracks between n + 1 constant matrices
+struct FlatView {
+  const glm::mat4 *folded;
+  const Track *tracks;
+  size_t n;
+
+  // A lone constant matrix, or a lone track
+  static FlatView Of(const glm::mat4 *m) { return {m, nullptr, 0}; }
+  static FlatView Of(const Track *t);
+};
+
+// Model transform as constant matrices between tracks,
+// folded[0] * tracks[0] * folded[1] * ... * folded[tracks.size()]
+struct Flat {
+  std::vector<glm::mat4> folded{glm::mat4(1.0)};
+  std::vector<Track> tracks;
+
+  void Then(const glm::mat4 &m) { folded.back() *= m; }
+  void Then(const Track &t) {
+    tracks.push_back(t);
+    folded.push_back(glm::mat4(1.0));
+  }
+  // Append another flattened transform of n tracks
+  void Then(const glm::mat4 *f, const Track *t, size_t n) {
+    Then(f[0]);
+    for (size_t k = 0; k < n; k++) {
+      Then(t[k]);
+      Then(f[k + 1]);
+    }
+  }
+  void Then(const FlatView &v) { Then(v.folded, v.tracks, v.n); }
+  FlatView View() const {
+    return {folded.data(), tracks.data(), tracks.size()};
+  }
+};
+
+// Matrix of a flattened transform of n tracks and n + 1 folded matrices
+glm::mat4 Compose(const glm::mat4 *folded, const Track *tracks, size_t n,
+                  const Frame &f);
+// Matrix of a flattened transform given its n tracks' evaluated matrices
+inline glm::mat4 Compose(const glm::mat4 *folded, const glm::mat4 *evaluated,
+                         size_t n) {
+  auto m = folded[0];
+  for (size_t k = 0; k < n; k++) {
+    m *= evaluated[k] * folded[k + 1];
+  }
+  return m;
+}
+
+// Model transforms of many objects, collected so their tracks are evaluated
+// in one batch. Buffers are kept between uses, so once warm this allocates
+// nothing unless a model has renderables rendering several matrices.
+class Models {
+ public:
+  void Clear();
+  void Add(const Renderable &model);
+  void Add(const std::vector<std::shared_ptr<Renderable>> &model);
+  // Append every added object's matrices, in order
+  void Evaluate(const Frame &f, std::vector<glm::mat4> *out);
+  void Evaluate(const Frame &f, std::pmr::vector<glm::mat4> *out);
+
+ private:
+  // A renderable of a model, its flattened constant matrices if it has
+  // them, and the index of its first track and how many it has
+  struct Stage {
+    const Renderable *renderable;
+    const glm::mat4 *folded;
+    uint32_t track, chained;
+  };
+
+  std::vector<Stage> stages;
+  // Per object, the end of its stages
+  std::vector<uint32_t> objects;
+  std::vector<Track> tracks;
+  std::vector<glm::mat4> evaluated;
+
+  // Add a stage of the object being added
+  void Push(const Renderable *r);
+  template <typename V>
+  void Append(const Frame &f, V *out);
+};
+
+}  // namespace renderer
+
+#endif  // SRC_RENDERER_ANIMATION_H_
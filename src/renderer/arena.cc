@@ -0,0 +1,60 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace renderer {
+
+namespace {
+
+// Allocations are rounded to this, keeping offsets aligned for most types
+const size_t kGrain = 16;
+// Alignment of the block itself
+const size_t kBlockAlign = 64;
+
+}  // namespace
+
+Arena::Arena(size_t c)
+    : block{static_cast<char *>(
+          std::pmr::new_delete_resource()->allocate(c, kBlockAlign))},
+      capacity{c} {}
+
+Arena::~Arena() {
+  Reset();
+  std::pmr::new_delete_resource()->deallocate(block, capacity, kBlockAlign);
+}
+
+void *Arena::do_allocate(size_t bytes, size_t alignment) {
+  auto n = (bytes + kGrain - 1) / kGrain * kGrain;
+  if (alignment > kGrain) {
+    n += alignment - kGrain;
+  }
+  auto offset = used.fetch_add(n);
+  if (offset + n <= capacity) {
+    auto p = reinterpret_cast<uintptr_t>(block + offset);
+    return reinterpret_cast<void *>((p + alignment - 1) & ~(alignment - 1));
+  }
+  // Past the block; still counted in used, so Reset grows the block to fit
+  std::unique_lock<std::mutex> lock(mutex);
+  auto p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  overflow.push_back({p, bytes, alignment});
+  return p;
+}
+
+void Arena::Reset() {
+  for (auto &o : overflow) {
+    std::pmr::new_delete_resource()->deallocate(o.p, o.bytes, o.alignment);
+  }
+  overflow.clear();
+  auto u = used.exchange(0);
+  if (u > capacity) {
+    std::pmr::new_delete_resource()->deallocate(block, capacity, kBlockAlign);
+    capacity = std::max(u, 2 * capacity);
+    block = static_cast<char *>(
+        std::pmr::new_delete_resource()->allocate(capacity, kBlockAlign));
+  }
+}
+
+}  // namespace renderer
@@ -0,0 +1,54 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_ARENA_H_
+#define SRC_RENDERER_ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace renderer {
+
+// Bump allocator for a frame's temporaries, used through std::pmr
+// containers. Allocating is an atomic bump into one block, so workers may
+// allocate concurrently, and deallocating does nothing: everything is
+// released at once by Reset. The block grows to the largest frame so far,
+// so once warm a frame makes no heap allocations.
+class Arena : public std::pmr::memory_resource {
+ public:
+  explicit Arena(size_t capacity = 1 << 20);
+  Arena(const Arena &) = delete;
+  ~Arena();
+
+  // Release every allocation, growing the block if the frame overflowed it.
+  // Nothing allocated since the last Reset may be used afterwards.
+  void Reset();
+  // Bytes allocated since the last Reset, counting alignment
+  size_t Used() const { return used.load(); }
+  size_t Capacity() const { return capacity; }
+
+ private:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *p, size_t bytes, size_t alignment) override {}
+  bool do_is_equal(const std::pmr::memory_resource &o) const
+      noexcept override {
+    return this == &o;
+  }
+
+  char *block;
+  size_t capacity;
+  std::atomic<size_t> used{0};
+  // Allocations which did not fit in the block, freed by Reset
+  struct Overflow {
+    void *p;
+    size_t bytes, alignment;
+  };
+  std::mutex mutex;
+  std::vector<Overflow> overflow;
+};
+
+}  // namespace renderer
+
+#endif  // SRC_RENDERER_ARENA_H_
@@ -3,34 +3,109 @@
 #ifndef SRC_RENDERER_BUILDER_H_
 #define SRC_RENDERER_BUILDER_H_
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <vector>
 
+#include "src/renderer/clock.h"
+#include "src/renderer/image.h"
 #include "src/renderer/renderer.h"
+#include "src/renderer/schedule.h"
+#include "src/renderer/renderers/gl/offscreen.h"
 #include "src/renderer/renderers/gl/renderer.h"
+#include "src/renderer/renderers/gl/window.h"
+#include "src/renderer/renderers/soft/renderer.h"
 
 namespace renderer {
 
 class Builder {
  public:
-  // Add model matrix
-  Builder View(std::shared_ptr<Renderable> v) {
-    view = v;
+  // Add a view of the scene; each view gets its own window
+  Builder &View(std::shared_ptr<Renderable> v) {
+    views.push_back(v);
     return *this;
   }
 
-  Builder Projection(
+  Builder &Projection(
       std::function<std::shared_ptr<Renderable>(size_t, size_t)> p) {
     projection = p;
     return *this;
   }
 
+  // Render each view offscreen at w by h instead of into a window
+  Builder &Headless(int w, int h) {
+    headless = true;
+    width = w;
+    height = h;
+    return *this;
+  }
+
+  // Rasterize on the CPU instead of through OpenGL, rendering headlessly at
+  // the Headless size
+  Builder &Software() {
+    software = true;
+    return *this;
+  }
+
+  // How frames are paced; unlimited by default
+  Builder &Pacing(Schedule s) {
+    schedule = s;
+    return *this;
+  }
+
+  // Advance animations by exactly step per frame rather than in real time,
+  // so runs render identical frames
+  Builder &Step(std::chrono::duration<double> step) {
+    clock = Clock::Step(step);
+    return *this;
+  }
+
+  // Where headless frames go; defaults to PPM files named after the views
+  Builder &Output(renderer::Output o) {
+    output = o;
+    return *this;
+  }
+
+  // Stop headless rendering after f frames per view; 0 renders forever
+  Builder &Frames(uint64_t f) {
+    frames = f;
+    return *this;
+  }
+
   std::shared_ptr<Renderer> Build() {
-    return std::shared_ptr<Renderer>(new gl::Renderer(view, projection));
+    if (software) {
+      return std::shared_ptr<Renderer>(new soft::Renderer(
+          views, projection, width, height,
+          output != nullptr ? output : WritePpm("view"), frames, clock));
+    }
+    auto h = headless;
+    auto w = width, ht = height;
+    auto o = output != nullptr ? output : WritePpm("view");
+    auto f = frames;
+    return std::shared_ptr<Renderer>(new gl::Renderer(
+        views, projection,
+        [=](size_t view, const gl::Surface *share) {
+          if (h) {
+            return std::unique_ptr<gl::Surface>(
+                new gl::Offscreen{w, ht, view, o, f, share});
+          }
+          return std::unique_ptr<gl::Surface>(
+              new gl::Window{"basilisk", 400, 400, share});
+        },
+        schedule, clock));
   }
 
  private:
-  std::shared_ptr<Renderable> view;
+  std::vector<std::shared_ptr<Renderable>> views;
   std::function<std::shared_ptr<Renderable>(size_t, size_t)> projection;
+  bool headless = false, software = false;
+  int width = 400, height = 400;
+  renderer::Output output;
+  uint64_t frames = 0;
+  Schedule schedule = Schedule::Unlimited();
+  Clock clock = Clock::Real();
 };
 
 }  // namespace renderer
@@ -0,0 +1,62 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/chain.h"
+
+#include <memory>
+#include <vector>
+
+namespace renderer {
+
+std::vector<glm::mat4> Sequence::Render(const Frame &f) const {
+  // Each stage's matrices are applied to every matrix so far
+  std::vector<glm::mat4> ms = {glm::mat4(1.0)}, next;
+  for (auto &s : stages) {
+    auto rendering = s->Render(f);
+    next.clear();
+    for (auto &a : ms) {
+      for (auto &b : rendering) {
+        next.push_back(a * b);
+      }
+    }
+    ms.swap(next);
+  }
+  return ms;
+}
+
+bool Sequence::Animated() const {
+  for (auto &s : stages) {
+    if (s->Animated()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Sequence::Matrix(const Frame &f, glm::mat4 *m) const {
+  glm::mat4 product(1.0), n;
+  for (auto &s : stages) {
+    if (s->Matrix(f, &n)) {
+      product *= n;
+    } else {
+      return false;
+    }
+  }
+  *m = product;
+  return true;
+}
+
+std::shared_ptr<Renderable> Chain(
+    const std::vector<std::shared_ptr<Renderable>> &model) {
+  if (model.size() == 1) {
+    return model.front();
+  }
+  Flat flat;
+  for (auto &r : model) {
+    if (!Flatten(*r, &flat)) {
+      return std::make_shared<Sequence>(model);
+    }
+  }
+  return std::make_shared<FlatChain>(std::move(flat));
+}
+
+}  // namespace renderer
@@ -0,0 +1,123 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_CHAIN_H_
+#define SRC_RENDERER_CHAIN_H_
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "src/renderer/animation.h"
+#include "src/renderer/renderer.h"
+
+namespace renderer {
+
+// Model transform of a sequence of stages fixed at compile time. Each stage
+// type has a static kConstant, true if it flattens to one unchanging matrix,
+// otherwise it flattens to a lone track.
+// Runs of constant stages are multiplied together on construction, so a
+// frame only evaluates the tracks, folded in by a product unrolled per chain
+// type.
+template <class... Stages>
+class TransformChain : public Renderable {
+ public:
+  explicit TransformChain(const Stages &... s);
+  std::vector<glm::mat4> Render(const Frame &f) const override;
+  bool Flattened(FlatView *v) const override {
+    *v = {folded.data(), tracks.data(), kTracks};
+    return true;
+  }
+  bool Matrix(const Frame &f, glm::mat4 *m) const override;
+
+ private:
+  static constexpr size_t kTracks = (0 + ... + (Stages::kConstant ? 0 : 1));
+
+  template <size_t... K>
+  glm::mat4 Unrolled(const glm::mat4 *evaluated,
+                     std::index_sequence<K...>) const {
+    auto m = folded[0];
+    ((m *= evaluated[K] * folded[K + 1]), ...);
+    return m;
+  }
+
+  std::array<Track, kTracks> tracks;
+  // Products of the constant stages before, between and after the tracks
+  std::array<glm::mat4, kTracks + 1> folded;
+};
+
+// Model transform of a flattened chain, owning its matrices and tracks
+class FlatChain : public Renderable {
+ public:
+  explicit FlatChain(Flat f) : flat{std::move(f)} {}
+  std::vector<glm::mat4> Render(const Frame &f) const override {
+    glm::mat4 m;
+    Matrix(f, &m);
+    return {m};
+  }
+  bool Flattened(FlatView *v) const override {
+    *v = flat.View();
+    return true;
+  }
+
+ private:
+  Flat flat;
+};
+
+// Model transform of renderables applied in order, for models which cannot
+// be flattened into one chain
+class Sequence : public Renderable {
+ public:
+  explicit Sequence(std::vector<std::shared_ptr<Renderable>> s)
+      : stages{std::move(s)} {}
+  std::vector<glm::mat4> Render(const Frame &f) const override;
+  bool Animated() const override;
+  bool Matrix(const Frame &f, glm::mat4 *m) const override;
+
+ private:
+  std::vector<std::shared_ptr<Renderable>> stages;
+};
+
+// One renderable applying a model's renderables in order: the only one, a
+// FlatChain if every one flattens, or else a Sequence
+std::shared_ptr<Renderable> Chain(
+    const std::vector<std::shared_ptr<Renderable>> &model);
+
+template <class... Stages>
+TransformChain<Stages...>::TransformChain(const Stages &... s) {
+  folded.fill(glm::mat4(1.0));
+  size_t k = 0;
+  auto add = [&](const auto &stage) {
+    FlatView v;
+    stage.Flattened(&v);
+    if constexpr (std::decay_t<decltype(stage)>::kConstant) {
+      folded[k] *= v.folded[0];
+    } else {
+      tracks[k++] = v.tracks[0];
+    }
+  };
+  (add(s), ...);
+}
+
+template <class... Stages>
+std::vector<glm::mat4> TransformChain<Stages...>::Render(
+    const Frame &f) const {
+  glm::mat4 m;
+  Matrix(f, &m);
+  return {m};
+}
+
+template <class... Stages>
+bool TransformChain<Stages...>::Matrix(const Frame &f, glm::mat4 *m) const {
+  std::array<glm::mat4, kTracks> evaluated;
+  Evaluate(tracks.data(), kTracks, f, evaluated.data());
+  *m = Unrolled(evaluated.data(), std::make_index_sequence<kTracks>{});
+  return true;
+}
+
+}  // namespace renderer
+
+#endif  // SRC_RENDERER_CHAIN_H_
@@ -0,0 +1,21 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/clock.h"
+
+namespace renderer {
+
+Clock::Clock(std::chrono::duration<double> s)
+    : start{std::chrono::steady_clock::now()}, step{s} {}
+
+Frame Clock::Tick() {
+  Frame f;
+  f.number = frames++;
+  if (step.count() > 0) {
+    f.time = step * static_cast<double>(f.number);
+  } else {
+    f.time = std::chrono::steady_clock::now() - start;
+  }
+  return f;
+}
+
+}  // namespace renderer
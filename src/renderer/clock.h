@@ -0,0 +1,38 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_CLOCK_H_
+#define SRC_RENDERER_CLOCK_H_
+
+#include <chrono>
+#include <cstdint>
+
+namespace renderer {
+
+// A frame's place in animation time, handed to everything evaluated for it
+struct Frame {
+  uint64_t number = 0;
+  std::chrono::duration<double> time{0};
+};
+
+// Animation clock of one renderer. Real time clocks run from their
+// creation; fixed step clocks advance exactly one step per frame, so their
+// frames replay identically however long each takes to render.
+class Clock {
+ public:
+  static Clock Real() { return Clock{std::chrono::duration<double>{0}}; }
+  static Clock Step(std::chrono::duration<double> step) { return Clock{step}; }
+
+  // Begin the next frame
+  Frame Tick();
+
+ private:
+  explicit Clock(std::chrono::duration<double> s);
+
+  std::chrono::steady_clock::time_point start;
+  std::chrono::duration<double> step;
+  uint64_t frames = 0;
+};
+
+}  // namespace renderer
+
+#endif  // SRC_RENDERER_CLOCK_H_
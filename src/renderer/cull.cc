@@ -0,0 +1,195 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/cull.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace renderer {
+
+namespace {
+
+// Key of a cell with no instances, e.g. for instances not yet placed
+const uint64_t kUnbinned = ~0ull;
+// Bits per packed cell coordinate
+const int kCoordBits = 21;
+// Cell width in bounding radii, and the range it may drift to before cells
+// are resized
+const float kCellRadii = 8, kMinCellRadii = 4, kMaxCellRadii = 16;
+
+int64_t unpack(uint64_t key, int axis) {
+  auto v = static_cast<int64_t>((key >> (axis * kCoordBits)) &
+                                ((1ull << kCoordBits) - 1));
+  return v - (1ll << (kCoordBits - 1));
+}
+
+}  // namespace
+
+Frustum::Frustum(const glm::mat4 &vp) {
+  // Gribb-Hartmann: each plane is the last row plus or minus another row
+  for (int i = 0; i < 6; i++) {
+    auto row = i / 2;
+    float sign = i % 2 == 0 ? 1 : -1;
+    x[i] = vp[0][3] + sign * vp[0][row];
+    y[i] = vp[1][3] + sign * vp[1][row];
+    z[i] = vp[2][3] + sign * vp[2][row];
+    w[i] = vp[3][3] + sign * vp[3][row];
+  }
+  for (int i = 6; i < 8; i++) {
+    x[i] = x[i - 2];
+    y[i] = y[i - 2];
+    z[i] = z[i - 2];
+    w[i] = w[i - 2];
+  }
+}
+
+Visibility Frustum::Classify(glm::vec3 c, glm::vec3 e) const {
+  // A box is outside a plane if its center is further behind it than the
+  // box's projected radius, and inside if further in front.
+  int outside = 0, partial = 0;
+#ifdef __SSE__
+  auto cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+  auto ex = _mm_set1_ps(e.x), ey = _mm_set1_ps(e.y), ez = _mm_set1_ps(e.z);
+  auto sign = _mm_set1_ps(-0.0f), zero = _mm_setzero_ps();
+  for (int i = 0; i < 8; i += 4) {
+    auto nx = _mm_load_ps(x + i), ny = _mm_load_ps(y + i),
+         nz = _mm_load_ps(z + i), nw = _mm_load_ps(w + i);
+    auto d = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+        _mm_add_ps(_mm_mul_ps(nz, cz), nw));
+    auto r = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign, nx), ex),
+                   _mm_mul_ps(_mm_andnot_ps(sign, ny), ey)),
+        _mm_mul_ps(_mm_andnot_ps(sign, nz), ez));
+    outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(d, r), zero));
+    partial |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(d, r), zero));
+  }
+#else
+  for (int i = 0; i < 6; i++) {
+    auto d = x[i] * c.x + y[i] * c.y + z[i] * c.z + w[i];
+    auto r = std::abs(x[i]) * e.x + std::abs(y[i]) * e.y + std::abs(z[i]) * e.z;
+    outside |= d + r < 0;
+    partial |= d - r < 0;
+  }
+#endif
+  if (outside) {
+    return Visibility::kOutside;
+  }
+  return partial ? Visibility::kPartial : Visibility::kInside;
+}
+
+Grid::Grid(float c) : cell{c} {}
+
+uint64_t Grid::Key(glm::vec3 p) const {
+  uint64_t key = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    auto v = static_cast<int64_t>(std::floor(p[axis] / cell)) +
+             (1ll << (kCoordBits - 1));
+    key |= (static_cast<uint64_t>(v) & ((1ull << kCoordBits) - 1))
+           << (axis * kCoordBits);
+  }
+  return key;
+}
+
+void Grid::Resize(size_t n) {
+  for (auto i = n; i < entries.size(); i++) {
+    Unbin(i);
+  }
+  entries.resize(n, Entry{glm::vec3{0, 0, 0}, kUnbinned, 0});
+}
+
+bool Grid::Place(size_t i, glm::vec3 center) {
+  entries[i].center = center;
+  return entries[i].key != Key(center);
+}
+
+bool Grid::Radius(float r) {
+  radius = r;
+  if (r <= 0 || (cell >= kMinCellRadii * r && cell <= kMaxCellRadii * r)) {
+    return false;
+  }
+  cell = kCellRadii * r;
+  for (auto &c : cells) {
+    c.second.clear();
+  }
+  while (!cells.empty()) {
+    spare.push_back(cells.extract(cells.begin()));
+  }
+  for (size_t i = 0; i < entries.size(); i++) {
+    entries[i].key = kUnbinned;
+    Rebin(i);
+  }
+  return true;
+}
+
+void Grid::Rebin(size_t i) {
+  Unbin(i);
+  auto &e = entries[i];
+  e.key = Key(e.center);
+  auto c = cells.find(e.key);
+  if (c == cells.end()) {
+    if (spare.empty()) {
+      c = cells.emplace(e.key, std::vector<size_t>{}).first;
+    } else {
+      auto node = std::move(spare.back());
+      spare.pop_back();
+      node.key() = e.key;
+      c = cells.insert(std::move(node)).position;
+    }
+  }
+  auto &members = c->second;
+  e.slot = members.size();
+  members.push_back(i);
+}
+
+void Grid::Unbin(size_t i) {
+  auto &e = entries[i];
+  if (e.key == kUnbinned) {
+    return;
+  }
+  // Swap-remove from the cell, fixing the slot of the moved instance
+  auto c = cells.find(e.key);
+  auto &members = c->second;
+  members[e.slot] = members.back();
+  entries[members[e.slot]].slot = e.slot;
+  members.pop_back();
+  e.key = kUnbinned;
+  // Emptied cells are dropped so culling never visits them, keeping their
+  // nodes so instances moving back and forth across a boundary do not
+  // reallocate them
+  if (members.empty()) {
+    spare.push_back(cells.extract(c));
+  }
+}
+
+void Grid::Cull(const Frustum &f, std::pmr::vector<size_t> *visible) const {
+  auto half = glm::vec3{cell / 2, cell / 2, cell / 2};
+  auto bound = glm::vec3{radius, radius, radius};
+  for (auto &c : cells) {
+    // Cells are widened by the radius so straddling instances are kept
+    auto center = glm::vec3{(unpack(c.first, 0) + 0.5f) * cell,
+                            (unpack(c.first, 1) + 0.5f) * cell,
+                            (unpack(c.first, 2) + 0.5f) * cell};
+    switch (f.Classify(center, half + bound)) {
+      case Visibility::kOutside:
+        break;
+      case Visibility::kInside:
+        visible->insert(visible->end(), c.second.begin(), c.second.end());
+        break;
+      case Visibility::kPartial:
+        for (auto i : c.second) {
+          if (f.Classify(entries[i].center, bound) != Visibility::kOutside) {
+            visible->push_back(i);
+          }
+        }
+        break;
+    }
+  }
+}
+
+}  // namespace renderer
@@ -0,0 +1,77 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_CULL_H_
+#define SRC_RENDERER_CULL_H_
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+namespace renderer {
+
+enum class Visibility { kOutside, kPartial, kInside };
+
+// View frustum of a view-projection matrix as six inward facing planes
+class Frustum {
+ public:
+  explicit Frustum(const glm::mat4 &vp);
+
+  // Classify the box with the given center and half extents, testing four
+  // planes at a time where SIMD is available
+  Visibility Classify(glm::vec3 center, glm::vec3 extent) const;
+
+ private:
+  // Plane coefficients, structure of arrays; planes 6 and 7 repeat 4 and 5
+  alignas(16) float x[8], y[8], z[8], w[8];
+};
+
+// Uniform hash grid over instance bounding spheres, refit incrementally: an
+// instance is only rebinned when it moves into another cell. Cells are sized
+// to the instances' bounds and only kept while they hold instances.
+class Grid {
+ public:
+  explicit Grid(float cell = 1);
+  Grid(const Grid &) = delete;
+
+  size_t Size() const { return entries.size(); }
+  size_t Cells() const { return cells.size(); }
+  // Grow or shrink to n instances; new instances are binned by Place
+  void Resize(size_t n);
+  // Set the center of instance i, returning whether it left its cell and
+  // needs Rebin. Safe to call concurrently for distinct instances.
+  bool Place(size_t i, glm::vec3 center);
+  // Move instance i into the cell its center is in
+  void Rebin(size_t i);
+  // Bounding radius every instance is culled with. Cells are a few radii
+  // wide; when r strays too far from that they are resized and every
+  // instance rebinned, returning true.
+  bool Radius(float r);
+
+  // Append the instances which may be visible in the frustum
+  void Cull(const Frustum &f, std::pmr::vector<size_t> *visible) const;
+
+ private:
+  struct Entry {
+    glm::vec3 center;
+    uint64_t key;
+    size_t slot;
+  };
+
+  uint64_t Key(glm::vec3 p) const;
+  void Unbin(size_t i);
+
+  using CellMap = std::unordered_map<uint64_t, std::vector<size_t>>;
+
+  float cell, radius = 0;
+  std::vector<Entry> entries;
+  CellMap cells;
+  // Nodes of emptied cells, reused with their capacity by new cells
+  std::vector<CellMap::node_type> spare;
+};
+
+}  // namespace renderer
+
+#endif  // SRC_RENDERER_CULL_H_
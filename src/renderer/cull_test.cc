@@ -0,0 +1,212 @@
+// Copyright 2016 Connor Taffe
+
+// Benchmarks binning and culling a million cubes, about a tenth of them in
+// view, while a few move every frame, checking the grid culls exactly what
+// testing every instance against the frustum does, sizes its cells to the
+// cubes and keeps no empty cells.
+
+#include <unistd.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#include "src/renderer/arena.h"
+#include "src/renderer/cull.h"
+#include "src/spool.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// A 100 cube lattice of unit cubes, three apart, centered on the camera
+const size_t kSide = 100, kInstances = kSide * kSide * kSide;
+const size_t kInstancesPerJob = 512;
+const size_t kJobs = (kInstances + kInstancesPerJob - 1) / kInstancesPerJob;
+const float kSpacing = 3, kCubeRadius = 1.7320508f;
+
+void check(bool ok, const char *what) {
+  if (!ok) {
+    std::cerr << "cull_test: FAIL: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+double since(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// Instances' centers and scale, prepared in jobs, laid out, placed in the
+// grid and culled as the GL renderer's passes do
+class Bench {
+ public:
+  Bench() : centers(kInstances) {
+    for (size_t i = 0; i < kInstances; i++) {
+      centers[i] = (glm::vec3(i % kSide, i / kSide % kSide, i / kSide / kSide) -
+                    glm::vec3(kSide / 2)) *
+                   kSpacing;
+    }
+  }
+
+  // Draw a frame, returning the instances visible through vp
+  std::pmr::vector<size_t> Frame(const glm::mat4 &vp) {
+    // Prepare
+    auto start = Clock::now();
+    std::pmr::vector<std::pmr::vector<glm::mat4>> jobs(kJobs, &arena);
+    Spool::Instance()->Parallel(kJobs, [&](size_t j) {
+      auto end = std::min(kInstances, (j + 1) * kInstancesPerJob);
+      for (auto i = j * kInstancesPerJob; i < end; i++) {
+        glm::mat4 m(scale);
+        m[3] = glm::vec4(centers[i], 1);
+        jobs[j].push_back(m);
+      }
+    });
+    prepare += since(start);
+
+    // Bin, then place in parallel
+    start = Clock::now();
+    std::pmr::vector<size_t> offsets(kJobs + 1, &arena);
+    for (size_t j = 0; j < kJobs; j++) {
+      offsets[j + 1] = offsets[j] + jobs[j].size();
+    }
+    auto models = static_cast<glm::mat4 *>(arena.allocate(
+        offsets.back() * sizeof(glm::mat4), alignof(glm::mat4)));
+    grid.Resize(offsets.back());
+    std::pmr::vector<std::pmr::vector<size_t>> moved(kJobs, &arena);
+    Spool::Instance()->Parallel(kJobs, [&](size_t j) {
+      std::uninitialized_copy(jobs[j].begin(), jobs[j].end(),
+                              models + offsets[j]);
+      for (auto i = offsets[j]; i < offsets[j + 1]; i++) {
+        if (grid.Place(i, glm::vec3(models[i][3]))) {
+          moved[j].push_back(i);
+        }
+      }
+    });
+    place += since(start);
+
+    start = Clock::now();
+    if (!grid.Radius(scale * kCubeRadius)) {
+      for (auto &m : moved) {
+        for (auto i : m) {
+          grid.Rebin(i);
+        }
+      }
+    }
+    refit += since(start);
+
+    start = Clock::now();
+    std::pmr::vector<size_t> visible{&arena};
+    grid.Cull(renderer::Frustum{vp}, &visible);
+    cull += since(start);
+
+    // Every instance tested against the frustum, for comparison
+    start = Clock::now();
+    renderer::Frustum frustum{vp};
+    std::pmr::vector<size_t> expected{&arena};
+    auto r = scale * kCubeRadius;
+    for (size_t i = 0; i < offsets.back(); i++) {
+      if (frustum.Classify(glm::vec3(models[i][3]), glm::vec3(r, r, r)) !=
+          renderer::Visibility::kOutside) {
+        expected.push_back(i);
+      }
+    }
+    brute += since(start);
+    frames++;
+
+    std::sort(visible.begin(), visible.end());
+    check(visible == expected, "the grid culled differently than the frustum");
+    return visible;
+  }
+
+  // Move n random instances by up to a few cubes
+  void Move(size_t n) {
+    std::uniform_real_distribution<float> offset{-2 * kSpacing, 2 * kSpacing};
+    for (size_t k = 0; k < n; k++) {
+      auto &c = centers[random() % kInstances];
+      c = c + glm::vec3(offset(random), offset(random), offset(random));
+    }
+  }
+
+  void Report(const char *what) {
+    std::cout << what << ": per frame, prepare " << prepare / frames
+              << "ms, bin and place " << place / frames << "ms, refit "
+              << refit / frames << "ms, grid cull " << cull / frames
+              << "ms vs testing every instance " << brute / frames << "ms; "
+              << grid.Cells() << " cells" << std::endl;
+    prepare = place = refit = cull = brute = 0;
+    frames = 0;
+  }
+
+  renderer::Arena arena;
+  renderer::Grid grid;
+  std::vector<glm::vec3> centers;
+  float scale = 1;
+
+ private:
+  std::mt19937_64 random{1};
+  double prepare = 0, place = 0, refit = 0, cull = 0, brute = 0;
+  size_t frames = 0;
+};
+
+}  // namespace
+
+int main() {
+  Spool::Instance()->Run();
+  // Looking down the x axis with a 75 degree field of view, which takes in
+  // about a tenth of the lattice
+  auto vp = glm::perspective(75 * 3.14159265f / 180, 1.0f, 0.1f, 1000.0f) *
+            glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(1, 0, 0),
+                        glm::vec3(0, 1, 0));
+  auto bench = std::unique_ptr<Bench>(new Bench{});
+  // The first frame bins every instance
+  bench->Frame(vp);
+  bench->arena.Reset();
+  bench->Report("binning");
+  size_t visible = 0;
+  for (int f = 0; f < 10; f++) {
+    bench->Move(kInstances / 100);
+    visible = bench->Frame(vp).size();
+    bench->arena.Reset();
+  }
+  std::cout << visible << " of " << kInstances << " cubes visible"
+            << std::endl;
+  check(visible > kInstances / 20 && visible < kInstances / 5,
+        "about a tenth of the cubes should be visible");
+  bench->Report("moving 1%");
+
+  // Cells are a few cube radii wide, so each holds tens of cubes, and are
+  // resized to cubes ten times larger
+  auto cells = bench->grid.Cells();
+  check(kInstances / cells >= 8 && kInstances / cells <= 256,
+        "cells were not sized to the cubes");
+  bench->scale = 10;
+  bench->Frame(vp);
+  bench->arena.Reset();
+  check(bench->grid.Cells() < cells / 100, "cells were not resized");
+  bench->scale = 1;
+  bench->Frame(vp);
+  bench->arena.Reset();
+  bench->Report("rescaling");
+
+  // Cells emptied by every cube leaving for one spot are dropped
+  for (auto &c : bench->centers) {
+    c = glm::vec3(10000, 0, 0);
+  }
+  bench->Frame(vp);
+  bench->arena.Reset();
+  check(bench->grid.Cells() == 1, "emptied cells were kept");
+  bench->Report("moving every cube");
+  std::cout << "cull_test: PASS" << std::endl;
+  // The spool singleton is never torn down
+  std::cout.flush();
+  _exit(0);
+}
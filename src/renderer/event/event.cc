@@ -0,0 +1,221 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/event/event.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "src/renderer/animation.h"
+#include "src/renderer/chain.h"
+
+namespace event {
+
+namespace {
+
+void encodeGeometry(const renderer::Rasterizable &r, journal::Encoder *e) {
+  e->Put<uint64_t>(r.VertexCount());
+  e->Put(r.Vertices(), r.VertexCount());
+  e->Put<uint64_t>(r.IndexCount());
+  e->Put(r.Indices(), r.IndexCount());
+}
+
+// FNV-1a hash of geometry's vertex and index bytes
+size_t hashGeometry(const std::vector<renderer::Vertex> &vertices,
+                    const std::vector<uint32_t> &indices) {
+  uint64_t h = 14695981039346656037ull;
+  auto mix = [&](const void *p, size_t len) {
+    auto b = static_cast<const unsigned char *>(p);
+    for (size_t i = 0; i < len; i++) {
+      h = (h ^ b[i]) * 1099511628211ull;
+    }
+  };
+  mix(vertices.data(), vertices.size() * sizeof(renderer::Vertex));
+  mix(indices.data(), indices.size() * sizeof(uint32_t));
+  return static_cast<size_t>(h);
+}
+
+// Decoded geometry is shared between events encoding the same bytes, so
+// replayed spawns are grouped as the recorded ones were
+std::shared_ptr<renderer::Rasterizable> decodeGeometry(journal::Decoder *d) {
+  auto vertices = d->Array<renderer::Vertex>(d->Get<uint64_t>());
+  auto indices = d->Array<uint32_t>(d->Get<uint64_t>());
+  for (auto i : indices) {
+    if (i >= vertices.size()) {
+      throw std::runtime_error("event::Spawn: index out of range");
+    }
+  }
+  auto h = hashGeometry(vertices, indices);
+  static std::mutex mutex;
+  static std::unordered_multimap<size_t, std::weak_ptr<renderer::Rasterizable>>
+      cache;
+  // Size of the cache when expired entries were last swept
+  static size_t swept = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  auto range = cache.equal_range(h);
+  for (auto c = range.first; c != range.second; c++) {
+    auto g = c->second.lock();
+    if (g != nullptr && g->VertexCount() == vertices.size() &&
+        g->IndexCount() == indices.size() &&
+        std::memcmp(g->Vertices(), vertices.data(),
+                    vertices.size() * sizeof(renderer::Vertex)) == 0 &&
+        std::memcmp(g->Indices(), indices.data(),
+                    indices.size() * sizeof(uint32_t)) == 0) {
+      return g;
+    }
+  }
+  // Entries of geometry no longer spawned are swept each time the cache
+  // doubles, so it stays proportional to the geometry alive
+  if (cache.size() >= 2 * swept) {
+    for (auto c = cache.begin(); c != cache.end();) {
+      c = c->second.expired() ? cache.erase(c) : std::next(c);
+    }
+    swept = std::max<size_t>(cache.size(), 16);
+  }
+  std::shared_ptr<renderer::Rasterizable> geometry =
+      std::make_shared<renderer::shapes::Geometry>(std::move(vertices),
+                                                   std::move(indices));
+  cache.insert({h, geometry});
+  return geometry;
+}
+
+// Encode the n renderables of a model as one flattened chain
+bool encodeModel(const std::shared_ptr<renderer::Renderable> *m, size_t n,
+                 journal::Encoder *e) {
+  renderer::Flat flat;
+  for (size_t i = 0; i < n; i++) {
+    if (!renderer::Flatten(*m[i], &flat)) {
+      return false;
+    }
+  }
+  e->Put<uint32_t>(flat.tracks.size());
+  e->Put(flat.tracks.data(), flat.tracks.size());
+  e->Put(flat.folded.data(), flat.folded.size());
+  return true;
+}
+
+std::shared_ptr<renderer::Renderable> decodeModel(journal::Decoder *d) {
+  renderer::Flat flat;
+  flat.tracks = d->Array<renderer::Track>(d->Get<uint32_t>());
+  flat.folded = d->Array<glm::mat4>(flat.tracks.size() + 1);
+  return std::make_shared<renderer::FlatChain>(std::move(flat));
+}
+
+const bool spawnRegistered = journal::Register(
+    journal::Tag("event::Spawn"), [](journal::Decoder *d) {
+      auto geometry = decodeGeometry(d);
+      auto handle = renderer::Handles::Instance()->Translate(
+          d->Origin(), d->Get<renderer::Handle>());
+      return std::shared_ptr<Event>{
+          new Spawn{geometry, {decodeModel(d)}, handle}};
+    });
+
+const bool batchRegistered = journal::Register(
+    journal::Tag("event::SpawnBatch"), [](journal::Decoder *d) {
+      std::vector<std::shared_ptr<renderer::Rasterizable>> displays;
+      for (auto n = d->Get<uint32_t>(); n > 0; n--) {
+        displays.push_back(decodeGeometry(d));
+      }
+      // Each record is at least its geometry, handle, track count and a
+      // matrix
+      auto n = d->Get<uint64_t>();
+      if (n > d->Remaining() / (2 * sizeof(uint32_t) +
+                                sizeof(renderer::Handle) +
+                                sizeof(glm::mat4))) {
+        throw std::runtime_error("event::SpawnBatch: truncated");
+      }
+      std::vector<SpawnBatch::Record> records(n);
+      for (auto &r : records) {
+        auto display = d->Get<uint32_t>();
+        if (display >= displays.size()) {
+          throw std::runtime_error("event::SpawnBatch: bad geometry");
+        }
+        r.display = displays[display];
+        r.handle = renderer::Handles::Instance()->Translate(
+            d->Origin(), d->Get<renderer::Handle>());
+        r.model = decodeModel(d);
+      }
+      return std::shared_ptr<Event>{new SpawnBatch{std::move(records)}};
+    });
+
+const bool viewRegistered = journal::Register(
+    journal::Tag("event::View"), [](journal::Decoder *d) {
+      auto view = d->Get<uint64_t>();
+      return std::shared_ptr<Event>{new View{view, decodeModel(d)}};
+    });
+
+const bool despawnRegistered = journal::Register(
+    journal::Tag("event::Despawn"), [](journal::Decoder *d) {
+      // Handles were given by the recording process, so the local handles
+      // standing for them are removed and released instead
+      auto handles = d->Array<renderer::Handle>(d->Get<uint64_t>());
+      std::vector<renderer::Handle> local;
+      local.reserve(handles.size());
+      for (auto h : handles) {
+        if (auto l = renderer::Handles::Instance()->Forget(d->Origin(), h)) {
+          local.push_back(l);
+        }
+      }
+      return std::shared_ptr<Event>{new Despawn{std::move(local)}};
+    });
+
+// An ended origin despawns nothing more, so its objects keep their local
+// handles and its translations are dropped
+const bool endRegistered = journal::RegisterEnd(
+    [](uint32_t origin) { renderer::Handles::Instance()->Drop(origin); });
+
+}  // namespace
+
+Despawn::Despawn(std::vector<renderer::Handle> h) : handles{std::move(h)} {
+  for (auto handle : handles) {
+    renderer::Handles::Instance()->Release(handle);
+  }
+}
+
+bool Despawn::Encode(journal::Encoder *e) const {
+  e->Put<uint64_t>(handles.size());
+  e->Put(handles.data(), handles.size());
+  return true;
+}
+
+bool View::Encode(journal::Encoder *e) const {
+  e->Put<uint64_t>(view);
+  return encodeModel(&camera, 1, e);
+}
+
+bool Spawn::Encode(journal::Encoder *e) const {
+  encodeGeometry(*rasterizable, e);
+  e->Put(handle);
+  return encodeModel(renderers.data(), renderers.size(), e);
+}
+
+bool SpawnBatch::Encode(journal::Encoder *e) const {
+  // Geometry is written once however many records share it
+  std::vector<const renderer::Rasterizable *> displays;
+  std::unordered_map<const renderer::Rasterizable *, uint32_t> ids;
+  for (auto &r : records) {
+    if (ids.insert({r.display.get(), displays.size()}).second) {
+      displays.push_back(r.display.get());
+    }
+  }
+  e->Put<uint32_t>(displays.size());
+  for (auto d : displays) {
+    encodeGeometry(*d, e);
+  }
+  e->Put<uint64_t>(records.size());
+  for (auto &r : records) {
+    e->Put(ids[r.display.get()]);
+    e->Put(r.handle);
+    if (!encodeModel(&r.model, 1, e)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace event
@@ -5,18 +5,25 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "src/base.h"
+#include "src/journal.h"
+#include "src/renderer/handle.h"
 #include "src/renderer/renderer.h"
 
 namespace event {
 
+// Spawn an object, named by a handle given unless one is passed in
 class Spawn : public Event {
  public:
   Spawn(std::shared_ptr<renderer::Rasterizable> rast,
-        std::vector<std::shared_ptr<renderer::Renderable>> rend)
-      : rasterizable{rast}, renderers{rend} {}
+        std::vector<std::shared_ptr<renderer::Renderable>> rend,
+        renderer::Handle h = renderer::Handle{})
+      : rasterizable{rast},
+        renderers{rend},
+        handle{h ? h : renderer::Handles::Instance()->Acquire()} {}
   std::string Description() override {
     return "event::Spawn: A rasterizable was spawned";
   }
@@ -24,10 +31,90 @@ class Spawn : public Event {
   std::vector<std::shared_ptr<renderer::Renderable>> Model() {
     return renderers;
   }
+  // Handle to despawn the object with
+  renderer::Handle Id() const { return handle; }
+  uint32_t Kind() const override { return journal::Tag("event::Spawn"); }
+  // Journaled when every renderable of the model can be flattened
+  bool Encode(journal::Encoder *e) const override;
 
  private:
   std::shared_ptr<renderer::Rasterizable> rasterizable;
   std::vector<std::shared_ptr<renderer::Renderable>> renderers;
+  renderer::Handle handle;
+};
+
+// Many spawns delivered as one event, so they are fanned out to actors once
+// and applied by a renderer in one append
+class SpawnBatch : public Event {
+ public:
+  struct Record {
+    std::shared_ptr<renderer::Rasterizable> display;
+    // A single renderable, so records don't allocate per instance; several
+    // are combined with renderer::Chain
+    std::shared_ptr<renderer::Renderable> model;
+    // Given when the batch is made, if null
+    renderer::Handle handle;
+  };
+
+  explicit SpawnBatch(std::vector<Record> r) : records{std::move(r)} {
+    for (auto &record : records) {
+      if (!record.handle) {
+        record.handle = renderer::Handles::Instance()->Acquire();
+      }
+    }
+  }
+  std::string Description() override {
+    return "event::SpawnBatch: Rasterizables were spawned";
+  }
+  const std::vector<Record> &Records() const { return records; }
+  Priority Lane() const override { return Priority::kBulk; }
+  uint32_t Kind() const override {
+    return journal::Tag("event::SpawnBatch");
+  }
+  bool Encode(journal::Encoder *e) const override;
+
+ private:
+  std::vector<Record> records;
+};
+
+// Remove spawned objects by their handles, which are released for reuse.
+// Removals may overtake the spawns they name, e.g. a bulk batch, and are
+// still applied.
+class Despawn : public Event {
+ public:
+  explicit Despawn(std::vector<renderer::Handle> h);
+  std::string Description() override {
+    return "event::Despawn: Spawned objects were removed";
+  }
+  const std::vector<renderer::Handle> &Handles() const { return handles; }
+  uint32_t Kind() const override { return journal::Tag("event::Despawn"); }
+  bool Encode(journal::Encoder *e) const override;
+
+ private:
+  std::vector<renderer::Handle> handles;
+};
+
+// Move the camera of one of a renderer's views. Changes conflate, so a
+// renderer behind on its events only applies a view's latest camera.
+class View : public Event {
+ public:
+  View(size_t v, std::shared_ptr<renderer::Renderable> c)
+      : view{v}, camera{c} {}
+  std::string Description() override {
+    return "event::View: A view's camera moved";
+  }
+  size_t Index() const { return view; }
+  std::shared_ptr<renderer::Renderable> Camera() const { return camera; }
+  uint64_t Conflation() const override {
+    return static_cast<uint64_t>(Kind()) << 32 | view;
+  }
+  uint32_t Kind() const override { return journal::Tag("event::View"); }
+  // Journaled when the camera can be flattened
+  bool Encode(journal::Encoder *e) const override;
+
+ private:
+  size_t view;
+  std::shared_ptr<renderer::Renderable> camera;
 };
 
 }  // namespace event
@@ -0,0 +1,77 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/handle.h"
+
+namespace renderer {
+
+Handle Handles::Acquire() {
+  std::unique_lock<std::mutex> lock(mutex);
+  return Next();
+}
+
+Handle Handles::Next() {
+  if (free.empty()) {
+    generations.push_back(1);
+    return Handle{static_cast<uint32_t>(generations.size() - 1), 1};
+  }
+  auto i = free.back();
+  free.pop_back();
+  return Handle{i, generations[i]};
+}
+
+void Handles::Release(Handle h) {
+  std::unique_lock<std::mutex> lock(mutex);
+  Free(h);
+}
+
+void Handles::Free(Handle h) {
+  if (h.index >= generations.size() ||
+      generations[h.index] != h.generation) {
+    return;
+  }
+  // Generation 0 is the null handle's
+  if (++generations[h.index] == 0) {
+    generations[h.index] = 1;
+  }
+  free.push_back(h.index);
+}
+
+Handle Handles::Translate(uint32_t origin, Handle h) {
+  if (origin == 0 || !h) {
+    return h;
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  auto &t = translated[origin][h.index];
+  // A newer generation of the index is another object, so the older one's
+  // despawn was never seen
+  if (!t.second || t.first != h.generation) {
+    Free(t.second);
+    t = {h.generation, Next()};
+  }
+  return t.second;
+}
+
+Handle Handles::Forget(uint32_t origin, Handle h) {
+  if (origin == 0 || !h) {
+    return h;
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  auto o = translated.find(origin);
+  if (o == translated.end()) {
+    return Handle{};
+  }
+  auto t = o->second.find(h.index);
+  if (t == o->second.end() || t->second.first != h.generation) {
+    return Handle{};
+  }
+  auto local = t->second.second;
+  o->second.erase(t);
+  return local;
+}
+
+void Handles::Drop(uint32_t origin) {
+  std::unique_lock<std::mutex> lock(mutex);
+  translated.erase(origin);
+}
+
+}  // namespace renderer
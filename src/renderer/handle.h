@@ -0,0 +1,66 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_HANDLE_H_
+#define SRC_RENDERER_HANDLE_H_
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace renderer {
+
+// Stable name of a spawned object, given when it is spawned and used to
+// despawn it. Indices are reused once released, so a generation tells apart
+// the objects an index named; the null handle has generation 0.
+struct Handle {
+  uint32_t index = 0;
+  uint32_t generation = 0;
+
+  explicit operator bool() const { return generation != 0; }
+};
+
+// Allocator of the process' handles, reusing released indices so tables
+// indexed by them stay as large as the most objects alive at once. Handles
+// decoded from another origin, e.g. a replayed journal or another process,
+// are translated to local ones so they never collide with this process'.
+class Handles {
+ public:
+  static Handles *Instance() {
+    static Handles handles;
+    return &handles;
+  }
+
+  Handle Acquire();
+  // Make a handle's index reusable; stale handles are ignored
+  void Release(Handle h);
+  // Local handle standing for h of an origin, acquired when h is first
+  // seen; origin 0 is this process, whose handles are already local
+  Handle Translate(uint32_t origin, Handle h);
+  // Local handle of h, no longer translated, or the null handle if h was
+  // never seen; it is still to be released
+  Handle Forget(uint32_t origin, Handle h);
+  // Stop translating an origin's handles once it ends; objects it spawned
+  // keep their local handles
+  void Drop(uint32_t origin);
+
+ private:
+  std::mutex mutex;
+  // Current generation of each index, and the indices free for reuse
+  std::vector<uint32_t> generations;
+  std::vector<uint32_t> free;
+  // By origin and index, the generation of the other origin's handle and
+  // the local handle standing for it
+  std::unordered_map<
+      uint32_t, std::unordered_map<uint32_t, std::pair<uint32_t, Handle>>>
+      translated;
+
+  // Acquire and Release with the mutex held
+  Handle Next();
+  void Free(Handle h);
+};
+
+}  // namespace renderer
+
+#endif  // SRC_RENDERER_HANDLE_H_
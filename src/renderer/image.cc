@@ -0,0 +1,60 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/image.h"
+
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "src/util.h"
+
+namespace renderer {
+
+namespace {
+
+struct Frame {
+  std::string path;
+  Image image;
+};
+
+// Drains frames to disk on a single writer thread
+class PpmWriter {
+ public:
+  PpmWriter() : queue([](Frame f) { Write(f); }) { queue.Run(1); }
+  ~PpmWriter() {
+    queue.Kill();
+    queue.Wait();
+  }
+  void Put(Frame f) { queue.Put(f); }
+
+ private:
+  util::ConsumerQueue<Frame> queue;
+
+  static void Write(const Frame &f) {
+    std::ofstream out(f.path, std::ios::binary);
+    if (!out) {
+      throw std::runtime_error("renderer::WritePpm: cannot open " + f.path);
+    }
+    out << "P6\n" << f.image.width << " " << f.image.height << "\n255\n";
+    for (size_t i = 0; i < f.image.width * f.image.height; i++) {
+      out.write(reinterpret_cast<const char *>(&f.image.pixels[4 * i]), 3);
+    }
+  }
+};
+
+}  // namespace
+
+Output WritePpm(std::string prefix) {
+  auto writer = std::make_shared<PpmWriter>();
+  return [=](size_t view, uint64_t frame, const Image &image) {
+    std::stringstream path;
+    path << prefix << "-" << view << "-" << std::setw(6) << std::setfill('0')
+         << frame << ".ppm";
+    writer->Put({path.str(), image});
+  };
+}
+
+}  // namespace renderer
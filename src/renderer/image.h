@@ -0,0 +1,28 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_IMAGE_H_
+#define SRC_RENDERER_IMAGE_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace renderer {
+
+// A rendered frame as RGBA8 pixels, rows top to bottom
+struct Image {
+  size_t width = 0, height = 0;
+  std::vector<uint8_t> pixels;
+};
+
+// Receives every frame rendered into a view by a headless renderer
+using Output = std::function<void(size_t view, uint64_t frame, const Image &)>;
+
+// Output writing each frame to prefix-<view>-<frame>.ppm on its own thread,
+// so encoding and disk writes stay off the render thread
+Output WritePpm(std::string prefix);
+
+}  // namespace renderer
+
+#endif  // SRC_RENDERER_IMAGE_H_
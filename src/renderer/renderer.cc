@@ -2,15 +2,37 @@
 
 #include "src/renderer/renderer.h"
 
+#include <array>
+#include <functional>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
 namespace renderer {
 
 Rasterizable::~Rasterizable() {}
 
 Renderable::~Renderable() {}
 
-std::vector<glm::mat4> Renderable::Apply(std::vector<glm::mat4> m) {
+bool Renderable::Animated() const {
+  FlatView v;
+  return Flattened(&v) && v.n != 0;
+}
+
+bool Renderable::Matrix(const Frame &f, glm::mat4 *m) const {
+  FlatView v;
+  if (!Flattened(&v)) {
+    return false;
+  }
+  *m = Compose(v.folded, v.tracks, v.n, f);
+  return true;
+}
+
+std::vector<glm::mat4> Renderable::Apply(std::vector<glm::mat4> m,
+                                         const Frame &f) {
   std::vector<glm::mat4> nm;
-  auto rendering = Render();
+  auto rendering = Render(f);
   for (auto n : m) {
     for (auto r : rendering) {
       nm.push_back(n * r);
@@ -18,12 +40,48 @@ std::vector<glm::mat4> Renderable::Apply(std::vector<glm::mat4> m) {
   }
   return nm;
 }
-std::vector<glm::mat4> Renderable::Apply(Renderable *r) {
-  return Apply(r->Render());
+std::vector<glm::mat4> Renderable::Apply(Renderable *r, const Frame &f) {
+  return Apply(r->Render(f), f);
+}
+
+bool Flatten(const Renderable &r, Flat *f) {
+  FlatView v;
+  if (!r.Flattened(&v)) {
+    return false;
+  }
+  f->Then(v);
+  return true;
 }
 
 namespace shapes {
 
+std::shared_ptr<Geometry> CubeGeometry() {
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  auto random = std::bind(std::uniform_real_distribution<float>(0, 1),
+                          std::mt19937_64());
+  // Each face is a quad of four vertices sharing the face's normal,
+  // spanned by tangents u and v where u x v is the normal.
+  for (auto f : std::vector<std::array<glm::vec3, 3>>{
+           {glm::vec3{1, 0, 0}, glm::vec3{0, 0, -1}, glm::vec3{0, 1, 0}},
+           {glm::vec3{-1, 0, 0}, glm::vec3{0, 0, 1}, glm::vec3{0, 1, 0}},
+           {glm::vec3{0, 1, 0}, glm::vec3{1, 0, 0}, glm::vec3{0, 0, -1}},
+           {glm::vec3{0, -1, 0}, glm::vec3{1, 0, 0}, glm::vec3{0, 0, 1}},
+           {glm::vec3{0, 0, 1}, glm::vec3{1, 0, 0}, glm::vec3{0, 1, 0}},
+           {glm::vec3{0, 0, -1}, glm::vec3{-1, 0, 0}, glm::vec3{0, 1, 0}}}) {
+    auto base = static_cast<uint32_t>(vertices.size());
+    for (auto c : std::vector<std::pair<float, float>>{
+             {-1, -1}, {1, -1}, {1, 1}, {-1, 1}}) {
+      vertices.push_back({f[0] + f[1] * c.first + f[2] * c.second, f[0],
+                          glm::vec3{random(), random(), random()}});
+    }
+    for (auto i : {0, 1, 2, 0, 2, 3}) {
+      indices.push_back(base + i);
+    }
+  }
+  return std::make_shared<Geometry>(vertices, indices);
+}
+
 Factory::~Factory() {}
 
 }  // namespace shapes
@@ -4,31 +4,78 @@
 #define SRC_RENDERER_RENDERER_H_
 
 #include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "src/base.h"
-#include "src/renderer/timer.h"
+#include "src/renderer/animation.h"
+#include "src/renderer/clock.h"
 
 namespace renderer {
 
+// Interleaved vertex of indexed triangle geometry
+struct Vertex {
+  glm::vec3 position, normal, color;
+};
+
+// Indexed triangle list geometry, exposed in place without copying; the
+// pointers stay valid for the rasterizable's lifetime.
 class Rasterizable {
  public:
   virtual ~Rasterizable();
-  virtual std::vector<double> Vertices() const = 0;
+  virtual const Vertex *Vertices() const = 0;
+  virtual size_t VertexCount() const = 0;
+  virtual const uint32_t *Indices() const = 0;
+  virtual size_t IndexCount() const = 0;
 };
 
-// Renderable interface
+// Renderable interface, evaluated at a frame's animation time
 class Renderable {
  public:
   virtual ~Renderable();
-  virtual std::vector<glm::mat4> Render() const = 0;
+  virtual std::vector<glm::mat4> Render(const Frame &f) const = 0;
+  // Point v at this transform as constant matrices between tracks, or
+  // return false if Render is not always the single matrix they compose;
+  // those flattening can be evaluated in bulk with other objects' tracks
+  virtual bool Flattened(FlatView *v) const { return false; }
+  // Whether Render changes with time rather than only when modified, by
+  // default whether the flattened transform has tracks
+  virtual bool Animated() const;
+  // Write the single matrix Render would return without allocating, or
+  // return false if it may not return exactly one
+  virtual bool Matrix(const Frame &f, glm::mat4 *m) const;
 
-  std::vector<glm::mat4> Apply(std::vector<glm::mat4> m);
-  std::vector<glm::mat4> Apply(Renderable *r);
+  std::vector<glm::mat4> Apply(std::vector<glm::mat4> m, const Frame &f);
+  std::vector<glm::mat4> Apply(Renderable *r, const Frame &f);
 };
 
+// Append r's transform to f as constant matrices and tracks, or return false
+// if it does not flatten
+bool Flatten(const Renderable &r, Flat *f);
+
 namespace shapes {
 
+// Indexed triangle list owning its vertices and indices
+class Geometry : public Rasterizable {
+ public:
+  Geometry(std::vector<Vertex> v, std::vector<uint32_t> i)
+      : vertices{v}, indices{i} {}
+  const Vertex *Vertices() const override { return vertices.data(); }
+  size_t VertexCount() const override { return vertices.size(); }
+  const uint32_t *Indices() const override { return indices.data(); }
+  size_t IndexCount() const override { return indices.size(); }
+
+ private:
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+};
+
+// Cube of side 2 about the origin with a color per vertex, the same every
+// time so every backend draws the same cube
+std::shared_ptr<Geometry> CubeGeometry();
+
 class Factory {
  public:
   virtual ~Factory();
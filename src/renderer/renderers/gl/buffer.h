@@ -12,6 +12,8 @@
 #include <stdexcept>
 #include <vector>
 
+#include "src/renderer/renderers/gl/state.h"
+
 namespace gl {
 
 class VertexArray {
@@ -30,38 +32,45 @@ template <typename T>
 class Buffer {
  public:
   explicit Buffer(GLenum t = GL_ARRAY_BUFFER) : type{t} {
-    if (va == nullptr) {
-      va = new VertexArray{};
-    }
     glGenBuffers(1, &handle);
   }
   explicit Buffer(std::vector<T> values, GLenum t = GL_ARRAY_BUFFER)
       : Buffer(t) {
     Write(values);
   }
+  Buffer(const T *values, size_t n, GLenum t = GL_ARRAY_BUFFER) : Buffer(t) {
+    Write(values, n);
+  }
   Buffer(const Buffer &) = delete;
-  ~Buffer() { glDeleteBuffers(1, &handle); }
+  ~Buffer() {
+    glDeleteBuffers(1, &handle);
+    State::Released();
+  }
 
   size_t Size() const { return size; }
   GLuint Handle() const { return handle; }
 
-  void Write(std::vector<T> vec) {
+  void Write(std::vector<T> vec) { Write(vec.data(), vec.size()); }
+  void Write(const T *values, size_t n) {
     Bind();
-    size = vec.size();
-    glBufferData(type, sizeof(T) * size, vec.data(), GL_STATIC_DRAW);
+    size = n;
+    glBufferData(type, sizeof(T) * size, values, GL_STATIC_DRAW);
+  }
+  void Bind() {
+    auto s = State::Current();
+    if (s != nullptr) {
+      s->BindBuffer(type, handle);
+    } else {
+      glBindBuffer(type, handle);
+    }
   }
-  void Bind() { glBindBuffer(type, handle); }
 
  private:
-  static thread_local VertexArray *va;
   size_t size = {0};
   GLenum type;
   GLuint handle;
 };
 
-template <typename T>
-thread_local VertexArray *Buffer<T>::va = nullptr;
-
 }  // namespace gl
 
 template <typename T>
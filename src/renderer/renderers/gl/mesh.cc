@@ -0,0 +1,237 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/renderers/gl/mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace gl {
+
+namespace {
+
+// FNV-1a over the primitive type, vertex and index bytes
+size_t hash(GLenum type, const renderer::Vertex *v, size_t vc,
+            const GLuint *ind, size_t ic) {
+  uint64_t h = 14695981039346656037ull;
+  auto mix = [&](const void *p, size_t len) {
+    auto b = static_cast<const unsigned char *>(p);
+    for (size_t i = 0; i < len; i++) {
+      h = (h ^ b[i]) * 1099511628211ull;
+    }
+  };
+  mix(&type, sizeof(type));
+  mix(v, vc * sizeof(*v));
+  mix(ind, ic * sizeof(*ind));
+  return static_cast<size_t>(h);
+}
+
+// Reorder a triangle list for a post-transform vertex cache, after Tom
+// Forsyth's "Linear-Speed Vertex Cache Optimisation": repeatedly emit the
+// highest scoring triangle touching a simulated LRU cache, favouring recently
+// used vertices and those with few triangles left.
+std::vector<GLuint> optimize(const GLuint *in, size_t n, size_t vertices) {
+  const size_t kCache = 32;
+  auto triangles = n / 3;
+  std::vector<std::vector<size_t>> adjacent(vertices);
+  for (size_t t = 0; t < triangles; t++) {
+    for (size_t k = 0; k < 3; k++) {
+      adjacent[in[3 * t + k]].push_back(t);
+    }
+  }
+  std::vector<size_t> remaining(vertices);
+  for (size_t v = 0; v < vertices; v++) {
+    remaining[v] = adjacent[v].size();
+  }
+  std::vector<int> position(vertices, -1);
+  auto score = [&](size_t v) -> float {
+    if (remaining[v] == 0) {
+      return -1;
+    }
+    float s = 0;
+    if (position[v] >= 0 && position[v] < 3) {
+      // The last triangle's vertices score the same regardless of order
+      s = 0.75f;
+    } else if (position[v] >= 3) {
+      s = std::pow(1 - static_cast<float>(position[v] - 3) / (kCache - 3),
+                   1.5f);
+    }
+    return s + 2 * std::pow(static_cast<float>(remaining[v]), -0.5f);
+  };
+  std::vector<float> vertexScore(vertices), triangleScore(triangles, 0);
+  for (size_t v = 0; v < vertices; v++) {
+    vertexScore[v] = score(v);
+    for (auto t : adjacent[v]) {
+      triangleScore[t] += vertexScore[v];
+    }
+  }
+
+  std::vector<bool> emitted(triangles, false);
+  std::vector<GLuint> cache, out;
+  out.reserve(n);
+  size_t next = 0;
+  for (size_t e = 0; e < triangles; e++) {
+    size_t best = triangles;
+    for (auto v : cache) {
+      for (auto t : adjacent[v]) {
+        if (!emitted[t] &&
+            (best == triangles || triangleScore[t] > triangleScore[best])) {
+          best = t;
+        }
+      }
+    }
+    if (best == triangles) {
+      // Nothing cached is left to draw; start from the next unemitted one
+      while (emitted[next]) {
+        next++;
+      }
+      best = next;
+    }
+    emitted[best] = true;
+
+    std::vector<GLuint> lru(in + 3 * best, in + 3 * best + 3);
+    for (auto v : lru) {
+      out.push_back(v);
+      remaining[v]--;
+    }
+    for (auto v : cache) {
+      if (std::find(lru.begin(), lru.begin() + 3, v) == lru.begin() + 3) {
+        lru.push_back(v);
+      }
+    }
+    for (size_t i = 0; i < lru.size(); i++) {
+      position[lru[i]] = i < kCache ? static_cast<int>(i) : -1;
+    }
+    for (auto v : lru) {
+      auto s = score(v);
+      for (auto t : adjacent[v]) {
+        triangleScore[t] += s - vertexScore[v];
+      }
+      vertexScore[v] = s;
+    }
+    lru.resize(std::min(lru.size(), kCache));
+    cache = lru;
+  }
+  return out;
+}
+
+}  // namespace
+
+Mesh::Mesh(size_t i, GLenum t, const renderer::Vertex *v, size_t vc,
+           const GLuint *ind, size_t ic)
+    : id{i},
+      type{t},
+      vertices{v},
+      vertexCount{vc},
+      indices{ind},
+      indexCount{ic} {
+  for (size_t j = 0; j < vc; j++) {
+    radius = std::max(radius, glm::length(v[j].position));
+  }
+}
+
+std::shared_ptr<Mesh> Registry::Intern(GLenum type, const renderer::Vertex *v,
+                                       size_t vc, const GLuint *ind,
+                                       size_t ic) {
+  // Meshes are found by the geometry as given, so only a miss pays for
+  // reordering it
+  auto h = hash(type, v, vc, ind, ic);
+  std::unique_lock<std::mutex> lock(mutex);
+  if (auto mesh = Find(h, type, v, vc, ind, ic)) {
+    return mesh;
+  }
+  lock.unlock();
+  auto triangles = type == GL_TRIANGLES;
+  auto order = triangles ? optimize(ind, ic, vc) : std::vector<GLuint>{};
+  lock.lock();
+  // Another thread may have interned it meanwhile
+  if (auto mesh = Find(h, type, v, vc, ind, ic)) {
+    return mesh;
+  }
+  auto stored = indices.Store(triangles ? order.data() : ind, ic);
+  auto mesh = std::shared_ptr<Mesh>{
+      new Mesh{count++, type, vertices.Store(v, vc), vc, stored, ic}};
+  meshes.insert(
+      {h, Interned{triangles ? indices.Store(ind, ic) : stored, mesh}});
+  return mesh;
+}
+
+std::shared_ptr<Mesh> Registry::Find(size_t h, GLenum type,
+                                     const renderer::Vertex *v, size_t vc,
+                                     const GLuint *ind, size_t ic) {
+  auto range = meshes.equal_range(h);
+  for (auto m = range.first; m != range.second; m++) {
+    auto &mesh = m->second.mesh;
+    if (mesh->type == type && mesh->vertexCount == vc &&
+        mesh->indexCount == ic &&
+        std::memcmp(mesh->vertices, v, vc * sizeof(*v)) == 0 &&
+        std::memcmp(m->second.source, ind, ic * sizeof(GLuint)) == 0) {
+      return mesh;
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<Mesh> Registry::Intern(
+    std::shared_ptr<renderer::Rasterizable> r) {
+  auto m = std::dynamic_pointer_cast<Mesh>(r);
+  if (m != nullptr) {
+    return m;
+  }
+  auto g = std::dynamic_pointer_cast<Rasterizable>(r);
+  return Intern(g != nullptr ? g->Type() : GL_TRIANGLES, r->Vertices(),
+                r->VertexCount(), r->Indices(), r->IndexCount());
+}
+
+template <typename T>
+const T *Registry::Arena<T>::Store(const T *v, size_t n) {
+  if (n > kBlock) {
+    // Oversized geometry gets a block of its own, kept behind the block
+    // currently being filled
+    auto block = std::unique_ptr<T[]>{new T[n]};
+    std::copy(v, v + n, block.get());
+    auto d = block.get();
+    blocks.insert(blocks.empty() ? blocks.end() : blocks.end() - 1,
+                  std::move(block));
+    return d;
+  }
+  if (used + n > kBlock) {
+    blocks.emplace_back(new T[kBlock]);
+    used = 0;
+  }
+  auto d = blocks.back().get() + used;
+  std::copy(v, v + n, d);
+  used += n;
+  return d;
+}
+
+MeshBuffers::MeshBuffers(const Mesh &m)
+    : vertices{m.Vertices(), m.VertexCount()},
+      indices{m.Indices(), m.IndexCount(), GL_ELEMENT_ARRAY_BUFFER},
+      count{static_cast<GLsizei>(m.IndexCount())} {}
+
+void MeshBuffers::Bind() {
+  vertices.Bind();
+  // Every mesh shares the context's vertex array, so the attributes only
+  // need pointing at another mesh's vertices
+  auto s = State::Current();
+  if (s != nullptr && !s->PointAttributes(vertices.Handle())) {
+    indices.Bind();
+    return;
+  }
+  auto attribute = [](GLuint i, size_t offset) {
+    glVertexAttribPointer(i, 3, GL_FLOAT, false, sizeof(renderer::Vertex),
+                          reinterpret_cast<const void *>(offset));
+    glEnableVertexAttribArray(i);
+  };
+  attribute(0, offsetof(renderer::Vertex, position));
+  attribute(1, offsetof(renderer::Vertex, normal));
+  attribute(2, offsetof(renderer::Vertex, color));
+  indices.Bind();
+}
+
+}  // namespace gl
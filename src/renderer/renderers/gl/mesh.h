@@ -0,0 +1,121 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_RENDERERS_GL_MESH_H_
+#define SRC_RENDERER_RENDERERS_GL_MESH_H_
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "src/renderer/renderer.h"
+#include "src/renderer/renderers/gl/buffer.h"
+#include "src/renderer/renderers/gl/shapes.h"
+
+namespace gl {
+
+// Immutable, deduplicated indexed geometry. Vertices and indices live in the
+// Registry's arenas, and every spawn of the same geometry shares a Mesh.
+class Mesh : public Rasterizable {
+ public:
+  Mesh(const Mesh &) = delete;
+
+  // Stable, dense id of this geometry, assigned when first interned
+  size_t Id() const { return id; }
+  // Radius of the bounding sphere about the origin in model space
+  float Radius() const { return radius; }
+
+  const renderer::Vertex *Vertices() const override { return vertices; }
+  size_t VertexCount() const override { return vertexCount; }
+  const uint32_t *Indices() const override { return indices; }
+  size_t IndexCount() const override { return indexCount; }
+  GLenum Type() const override { return type; }
+
+ private:
+  friend class Registry;
+  Mesh(size_t i, GLenum t, const renderer::Vertex *v, size_t vc,
+       const GLuint *ind, size_t ic);
+
+  size_t id;
+  GLenum type;
+  const renderer::Vertex *vertices;
+  size_t vertexCount;
+  const GLuint *indices;
+  size_t indexCount;
+  float radius = 0;
+};
+
+// Process-wide mesh interning registry
+class Registry {
+ public:
+  static Registry *Instance() {
+    static Registry registry;
+    return &registry;
+  }
+
+  // Shared mesh with the given geometry, hashing it once and copying it into
+  // the arenas only the first time it is seen. Triangle lists have their
+  // indices reordered for the post-transform vertex cache when first seen,
+  // keeping a copy of the originals to match later geometry against.
+  std::shared_ptr<Mesh> Intern(GLenum type, const renderer::Vertex *v,
+                               size_t vc, const GLuint *ind, size_t ic);
+  std::shared_ptr<Mesh> Intern(std::shared_ptr<renderer::Rasterizable> r);
+
+ private:
+  Registry() {}
+  Registry(const Registry &) = delete;
+  Registry &operator=(const Registry &) = delete;
+
+  // Bump allocator over fixed blocks which never move once allocated
+  template <typename T>
+  class Arena {
+   public:
+    const T *Store(const T *v, size_t n);
+
+   private:
+    static const size_t kBlock = 1 << 14;
+    std::vector<std::unique_ptr<T[]>> blocks;
+    size_t used = kBlock;
+  };
+
+  // A mesh and the indices it was interned with, before reordering
+  struct Interned {
+    const GLuint *source;
+    std::shared_ptr<Mesh> mesh;
+  };
+
+  // Mesh already interned with the given geometry and hash, with the mutex
+  // held
+  std::shared_ptr<Mesh> Find(size_t h, GLenum type, const renderer::Vertex *v,
+                             size_t vc, const GLuint *ind, size_t ic);
+
+  std::mutex mutex;
+  // By hash of the geometry as given
+  std::unordered_multimap<size_t, Interned> meshes;
+  size_t count = 0;
+  Arena<renderer::Vertex> vertices;
+  Arena<GLuint> indices;
+};
+
+// GPU copy of a mesh's vertices and indices, uploaded once per context
+class MeshBuffers {
+ public:
+  explicit MeshBuffers(const Mesh &m);
+  MeshBuffers(const MeshBuffers &) = delete;
+
+  // Bind the buffers and point the position, normal and color attributes
+  // (locations 0, 1 and 2) at the interleaved vertices
+  void Bind();
+  GLsizei Count() const { return count; }
+
+ private:
+  Buffer<renderer::Vertex> vertices;
+  Buffer<GLuint> indices;
+  GLsizei count;
+};
+
+}  // namespace gl
+
+#endif  // SRC_RENDERER_RENDERERS_GL_MESH_H_
@@ -0,0 +1,256 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/renderers/gl/offscreen.h"
+
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace gl {
+
+namespace {
+
+// Process-wide EGL display, preferring Mesa's surfaceless platform which
+// needs no window system
+EGLDisplay eglDisplay() {
+  static EGLDisplay display = ([] {
+    auto getPlatformDisplay =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    auto d = EGL_NO_DISPLAY;
+    if (getPlatformDisplay != nullptr) {
+      d = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                             EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (d == EGL_NO_DISPLAY) {
+      d = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (d == EGL_NO_DISPLAY || !eglInitialize(d, nullptr, nullptr)) {
+      throw std::runtime_error("egl initialization failed");
+    }
+    return d;
+  })();
+  return display;
+}
+
+// Whether the display can make contexts current without a surface
+bool surfaceless(EGLDisplay d) {
+  static bool supported = ([&] {
+    auto e = eglQueryString(d, EGL_EXTENSIONS);
+    auto extensions = " " + std::string(e != nullptr ? e : "") + " ";
+    return extensions.find(" EGL_KHR_surfaceless_context ") !=
+           std::string::npos;
+  })();
+  return supported;
+}
+
+// Desktop GL config, which must also support pbuffers if contexts are made
+// current on one
+EGLConfig chooseConfig(EGLDisplay d) {
+  const EGLint attribs[] = {
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_SURFACE_TYPE,
+      surfaceless(d) ? 0 : EGL_PBUFFER_BIT, EGL_NONE};
+  EGLConfig config;
+  EGLint n;
+  if (!eglChooseConfig(d, attribs, &config, 1, &n) || n == 0) {
+    throw std::runtime_error("egl has no desktop gl config");
+  }
+  return config;
+}
+
+}  // namespace
+
+Offscreen::Binding::Binding(EGLDisplay d, EGLContext c, EGLSurface surface,
+                            State *s)
+    : Surface::Binding{s},
+      display{eglGetCurrentDisplay()},
+      context{eglGetCurrentContext()},
+      draw{eglGetCurrentSurface(EGL_DRAW)},
+      read{eglGetCurrentSurface(EGL_READ)},
+      switched{context != c} {
+  s->Switch(switched);
+  if (switched && !eglMakeCurrent(d, surface, surface, c)) {
+    throw std::runtime_error("gl::Offscreen: cannot make context current");
+  }
+}
+
+Offscreen::Binding::~Binding() {
+  if (!switched) {
+    return;
+  }
+  auto restored =
+      display == EGL_NO_DISPLAY
+          ? eglMakeCurrent(eglDisplay(), EGL_NO_SURFACE, EGL_NO_SURFACE,
+                           EGL_NO_CONTEXT)
+          : eglMakeCurrent(display, draw, read, context);
+  // Destructors cannot throw, so a failure is reported instead
+  if (!restored) {
+    std::cerr << "gl::Offscreen: cannot restore the previous context"
+              << std::endl;
+  }
+}
+
+Offscreen::Offscreen(int w, int h, size_t v, renderer::Output o, uint64_t f,
+                     const Surface *share)
+    : width{w},
+      height{h},
+      view{v},
+      output{o},
+      frames{f},
+      display{eglDisplay()},
+      config{chooseConfig(display)},
+      context{([&] {
+        auto s = dynamic_cast<const Offscreen *>(share);
+        if (share != nullptr && s == nullptr) {
+          throw std::runtime_error(
+              "gl::Offscreen: can only share a context with an Offscreen");
+        }
+        // The bound API is per thread, so bind it where contexts are made
+        eglBindAPI(EGL_OPENGL_API);
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK,
+            EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+        auto c = eglCreateContext(
+            display, config, s == nullptr ? EGL_NO_CONTEXT : s->context,
+            contextAttribs);
+        if (c == EGL_NO_CONTEXT) {
+          throw std::runtime_error("egl create context failed");
+        }
+        return c;
+      })()} {
+  // A constructor which throws is never destructed, so whatever was made
+  // is released here
+  try {
+    Create();
+  } catch (...) {
+    Release();
+    throw;
+  }
+}
+
+Offscreen::~Offscreen() {
+  {
+    auto b = Bind();
+    // Flush every frame still in flight
+    while (delivered < frame) {
+      Deliver();
+    }
+  }
+  Release();
+}
+
+void Offscreen::Create() {
+  if (!surfaceless(display)) {
+    // Drawing goes to the framebuffer object, so any surface will do
+    const EGLint attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    surface = eglCreatePbufferSurface(display, config, attribs);
+    if (surface == EGL_NO_SURFACE) {
+      throw std::runtime_error("gl::Offscreen: cannot create a pbuffer");
+    }
+  }
+  auto b = Bind();
+  glewExperimental = true;
+  auto err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+  // GLEW built for GLX loads the GL entry points before failing on GLX
+  if (err == GLEW_ERROR_NO_GLX_DISPLAY) {
+    err = GLEW_OK;
+  }
+#endif
+  if (err != GLEW_OK) {
+    throw std::runtime_error("failed to initialize glew");
+  }
+  vertexArray.reset(new VertexArray{});
+
+  glGenRenderbuffers(1, &color);
+  glBindRenderbuffer(GL_RENDERBUFFER, color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glGenRenderbuffers(1, &depth);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, color);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    throw std::runtime_error("gl::Offscreen: incomplete framebuffer");
+  }
+  glViewport(0, 0, width, height);
+
+  glGenBuffers(kRing, pixels.data());
+  for (auto p : pixels) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, p);
+    glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, nullptr,
+                 GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  fences.fill(nullptr);
+}
+
+void Offscreen::Release() {
+  // GL objects can only be deleted once GL is loaded; names never made are
+  // zero, which GL ignores
+  if (vertexArray != nullptr) {
+    auto b = Bind();
+    vertexArray = nullptr;
+    glDeleteBuffers(kRing, pixels.data());
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &color);
+    glDeleteRenderbuffers(1, &depth);
+  }
+  if (surface != EGL_NO_SURFACE) {
+    eglDestroySurface(display, surface);
+  }
+  eglDestroyContext(display, context);
+}
+
+void Offscreen::Swap() {
+  auto b = Bind();
+  if (frame - delivered == kRing) {
+    // The ring is full; free the oldest slot for this frame
+    Deliver();
+  }
+  auto slot = frame % kRing;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pixels[slot]);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  frame++;
+}
+
+void Offscreen::Deliver() {
+  auto slot = delivered % kRing;
+  glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+                   GL_TIMEOUT_IGNORED);
+  glDeleteSync(fences[slot]);
+  fences[slot] = nullptr;
+
+  renderer::Image image;
+  image.width = width;
+  image.height = height;
+  image.pixels.resize(width * height * 4);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pixels[slot]);
+  auto data = static_cast<const uint8_t *>(glMapBufferRange(
+      GL_PIXEL_PACK_BUFFER, 0, width * height * 4, GL_MAP_READ_BIT));
+  // GL rows run bottom to top
+  auto stride = static_cast<size_t>(width) * 4;
+  for (size_t y = 0; y < image.height; y++) {
+    std::memcpy(&image.pixels[y * stride],
+                data + (image.height - 1 - y) * stride, stride);
+  }
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (output) {
+    output(view, delivered, image);
+  }
+  delivered++;
+}
+
+}  // namespace gl
@@ -0,0 +1,90 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_RENDERERS_GL_OFFSCREEN_H_
+#define SRC_RENDERER_RENDERERS_GL_OFFSCREEN_H_
+
+#include <EGL/egl.h>
+#include <GL/glew.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "src/renderer/image.h"
+#include "src/renderer/renderers/gl/buffer.h"
+#include "src/renderer/renderers/gl/surface.h"
+
+namespace gl {
+
+// Headless surface: a surfaceless EGL context (Mesa's llvmpipe needs neither
+// a display nor a GPU), or one on a 1x1 pbuffer where the display lacks
+// EGL_KHR_surfaceless_context, rendering into a framebuffer object. Frames
+// are read back asynchronously through a ring of pixel buffers and handed to
+// an Output a few frames later, so readback never stalls the pipeline.
+class Offscreen : public Surface {
+ public:
+  // Renders view's frames at w by h, closing after frames frames unless
+  // frames is 0; objects in share's context, if any, are shared with this
+  // one's and share must be another Offscreen
+  Offscreen(int w, int h, size_t view, renderer::Output output,
+            uint64_t frames = 0, const Surface *share = nullptr);
+  Offscreen(const Offscreen &) = delete;
+  ~Offscreen();
+
+  class Binding : public Surface::Binding {
+   public:
+    // Switches context only if c is not already current, making it current
+    // on surface and throwing if that fails
+    Binding(EGLDisplay d, EGLContext c, EGLSurface surface, State *s);
+    Binding(const Binding &) = delete;
+    ~Binding();
+
+   private:
+    EGLDisplay display;
+    EGLContext context;
+    EGLSurface draw, read;
+    bool switched;
+  };
+
+  std::unique_ptr<Surface::Binding> Bind() const override {
+    return std::unique_ptr<Surface::Binding>(
+        new Binding(display, context, surface, state.get()));
+  }
+  void Swapiness(int i) override {}
+  void Swap() override;
+  bool Closed() override { return frames != 0 && frame >= frames; }
+  int Width() const override { return width; }
+  int Height() const override { return height; }
+
+ private:
+  // Frames in flight between rendering and readback
+  static const size_t kRing = 3;
+
+  // Make the pbuffer if needed, load GL and make the framebuffer and pixel
+  // buffers
+  void Create();
+  // Delete whatever Create made, then the context
+  void Release();
+  // Map the oldest frame in flight and hand it to the output
+  void Deliver();
+
+  int width, height;
+  size_t view;
+  renderer::Output output;
+  uint64_t frames, frame = 0, delivered = 0;
+  EGLDisplay display;
+  EGLConfig config;
+  EGLContext context;
+  // The pbuffer contexts are current on, if they cannot be surfaceless
+  EGLSurface surface = EGL_NO_SURFACE;
+  // Zero until made
+  GLuint framebuffer = 0, color = 0, depth = 0;
+  std::array<GLuint, kRing> pixels{};
+  std::array<GLsync, kRing> fences;
+  std::unique_ptr<VertexArray> vertexArray;
+  std::unique_ptr<State> state{new State{}};
+};
+
+}  // namespace gl
+
+#endif  // SRC_RENDERER_RENDERERS_GL_OFFSCREEN_H_
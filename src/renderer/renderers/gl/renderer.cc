@@ -3,195 +3,420 @@
 #include "src/renderer/renderers/gl/renderer.h"
 
 #include <GL/glew.h>
-#include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
-#include <fstream>
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include <map>
-#include <random>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "src/events.h"
+#include "src/renderer/animation.h"
+#include "src/renderer/chain.h"
 #include "src/renderer/event/event.h"
 #include "src/renderer/renderer.h"
 #include "src/renderer/renderers/gl/buffer.h"
+#include "src/renderer/renderers/gl/mesh.h"
 #include "src/renderer/renderers/gl/shader.h"
+#include "src/renderer/renderers/gl/shaders/triangle.h"
 #include "src/renderer/renderers/gl/shapes.h"
-#include "src/renderer/renderers/gl/window.h"
+#include "src/renderer/renderers/gl/surface.h"
 #include "src/spool.h"
 
 namespace gl {
 namespace {
 
-template <typename T>
-class VertexAttributePointer {
- public:
-  VertexAttributePointer(Buffer<T> *b, GLuint i, size_t size, GLenum type,
-                         std::ptrdiff_t stride)
-      : buffer{b}, handle{i} {
-    buffer->Bind();
-    // TODO(cptaffe): figure out type from T
-    glVertexAttribPointer(i, size, type, false, stride, nullptr);
-    glEnableVertexAttribArray(i);
-  }
-  VertexAttributePointer(const VertexAttributePointer &other) = delete;
-  ~VertexAttributePointer() { glDisableVertexAttribArray(handle); }
-
- private:
-  Buffer<T> *buffer;
-  GLuint handle;
-};
+// Instances whose matrices are computed by a single frame preparation job
+const size_t kInstancesPerJob = 512;
+// Length of the shader's model_view_projection uniform array
+const size_t kInstancesPerDraw = 1024;
+// Frames drawn between reports of how much GL state was redundant
+const uint64_t kReportFrames = 1000;
+
+// Per-user directory linked programs are cached in, if any
+std::string programCache() {
+  if (auto xdg = std::getenv("XDG_CACHE_HOME")) {
+    return std::string(xdg) + "/actor";
+  }
+  if (auto home = std::getenv("HOME")) {
+    return std::string(home) + "/.cache/actor";
+  }
+  return "";
+}
+
+// Multiply m by r's matrices at f, allocating only if r renders several
+void apply(const renderer::Renderable &r, const renderer::Frame &f,
+           glm::mat4 *m) {
+  glm::mat4 n;
+  if (r.Matrix(f, &n)) {
+    *m *= n;
+  } else {
+    for (auto &i : r.Render(f)) {
+      *m *= i;
+    }
+  }
+}
 
 }  // namespace
 
-RenderPass::RenderPass(
-    std::shared_ptr<Rasterizable> rend, std::vector<size_t> ind,
-    std::shared_ptr<renderer::Renderable> view,
-    std::shared_ptr<renderer::Renderable> projection,
-    const std::vector<std::vector<std::shared_ptr<renderer::Renderable>>>
-        &model,
-    GLint h)
-    : rasterizable{rend}, indices{ind}, mvpHandle{h} {
-  auto v = glm::mat4(1.0), p = glm::mat4(1.0);
-  for (auto i : view->Render()) {
-    v *= i;
+RenderPass::RenderPass(std::shared_ptr<const Scene::Snapshot> s, size_t g,
+                       renderer::Frame f,
+                       const std::pmr::vector<glm::mat4> &vps,
+                       renderer::Grid *gr, std::pmr::memory_resource *arena)
+    : snapshot{s},
+      group{(*s)[g]},
+      mesh{group[0].mesh},
+      frame{f},
+      viewProjections{vps, arena},
+      grid{gr},
+      jobs(Jobs(), arena),
+      models{nullptr, Release{arena, 0}},
+      offsets{arena},
+      moved(Jobs(), arena),
+      radii(Jobs(), arena),
+      mvp(vps.size(), arena) {}
+
+size_t RenderPass::Jobs() const {
+  return (group.Size() + kInstancesPerJob - 1) / kInstancesPerJob;
+}
+
+void RenderPass::Prepare(size_t job) {
+  auto &matrices = jobs[job];
+  matrices.clear();
+  auto end = std::min(group.Size(), (job + 1) * kInstancesPerJob);
+  // Kept per worker so evaluating animation does not allocate once warm
+  thread_local renderer::Models models;
+  models.Clear();
+  for (auto i = job * kInstancesPerJob; i < end; i++) {
+    models.Add(*group[i].model);
   }
-  for (auto i : projection->Render()) {
-    p *= i;
+  models.Evaluate(frame, &matrices);
+}
+
+void RenderPass::Bin() {
+  // Only each job's offset is found here; the matrices are copied by Place
+  // on the workers, left uninitialized until then
+  offsets.resize(jobs.size() + 1);
+  offsets[0] = 0;
+  for (size_t j = 0; j < jobs.size(); j++) {
+    offsets[j + 1] = offsets[j] + jobs[j].size();
   }
-  for (auto i : indices) {
-    for (auto m : ([&] {
-           std::vector<glm::mat4> matrices = {glm::mat4(1.0)};
-           for (auto r : model[i]) {
-             matrices = r->Apply(matrices);
-           }
-           return matrices;
-         })()) {
-      mvp.push_back(p * v * m);
+  auto n = offsets.back();
+  auto resource = offsets.get_allocator().resource();
+  models = {static_cast<glm::mat4 *>(resource->allocate(
+                n * sizeof(glm::mat4), alignof(glm::mat4))),
+            Release{resource, n}};
+  grid->Resize(n);
+}
+
+void RenderPass::Place(size_t job) {
+  std::uninitialized_copy(jobs[job].begin(), jobs[job].end(),
+                          &models[offsets[job]]);
+  moved[job].clear();
+  radii[job] = 0;
+  for (auto i = offsets[job]; i < offsets[job + 1]; i++) {
+    auto &m = models[i];
+    // The mesh's bounding sphere scaled by the largest axis scale
+    auto scale = std::max({glm::length(glm::vec3(m[0])),
+                           glm::length(glm::vec3(m[1])),
+                           glm::length(glm::vec3(m[2]))});
+    radii[job] = std::max(radii[job], scale * mesh->Radius());
+    if (grid->Place(i, glm::vec3(m[3]))) {
+      moved[job].push_back(i);
     }
   }
 }
 
-void RenderPass::Render() {
-  glUniformMatrix4fv(mvpHandle, mvp.size(), false, &mvp.data()[0][0][0]);
-  auto random = std::bind(std::uniform_real_distribution<GLfloat>(0, 1),
-                          std::mt19937_64());
-  vertices.clear();
-  rasterizable->Rasterize(&vertices);
-  colors.clear();
-  for (size_t i = 0; i < vertices.size(); i++) {
-    for (size_t j = 0; j < 3; j++) {
-      colors.push_back(random());
+void RenderPass::Refit() {
+  // Cells sized to the instances' bounds; resizing them rebins every
+  // instance, moved or not
+  if (grid->Radius(*std::max_element(radii.begin(), radii.end()))) {
+    return;
+  }
+  for (auto &m : moved) {
+    for (auto i : m) {
+      grid->Rebin(i);
     }
   }
+}
 
-  Buffer<GLfloat> cb{colors}, vb{vertices};
-
-  auto vptrs = std::vector<std::shared_ptr<VertexAttributePointer<GLfloat>>>();
-  {
-    auto buffers = std::vector<Buffer<GLfloat> *>({&vb, &cb});
-    for (size_t i = 0; i < buffers.size(); i++) {
-      vptrs.push_back(std::shared_ptr<VertexAttributePointer<GLfloat>>(
-          new VertexAttributePointer<GLfloat>(
-              buffers[i], static_cast<GLuint>(i), 3, GL_FLOAT, 0)));
-    }
+void RenderPass::Cull(size_t view) {
+  auto &vp = viewProjections[view];
+  std::pmr::vector<size_t> visible{mvp.get_allocator().resource()};
+  grid->Cull(renderer::Frustum{vp}, &visible);
+  mvp[view].clear();
+  mvp[view].reserve(visible.size());
+  for (auto i : visible) {
+    mvp[view].push_back(vp * models[i]);
   }
+}
 
-  glDrawArraysInstanced(rasterizable->Type(), 0, vb.Size() * sizeof(GLfloat),
-                        indices.size());
+void RenderPass::Render(size_t view, GLint mvpHandle, MeshBuffers *buffers) {
+  auto &m = mvp[view];
+  buffers->Bind();
+  // Instances beyond the uniform array's length are drawn in further batches
+  for (size_t i = 0; i < m.size(); i += kInstancesPerDraw) {
+    auto n = std::min(kInstancesPerDraw, m.size() - i);
+    glUniformMatrix4fv(mvpHandle, n, false, &m[i][0][0]);
+    glDrawElementsInstanced(mesh->Type(), buffers->Count(), GL_UNSIGNED_INT,
+                            nullptr, n);
+  }
 }
 
 RenderThread::RenderThread(
-    std::function<std::vector<RenderPass>(Window *, GLint)> renderf)
-    : window{"basilisk", 400, 400},
+    size_t views, SurfaceFactory surface, renderer::Schedule s,
+    std::function<bool(const Surfaces &, RenderPasses *)> renderf)
+    : surfaces{([&] {
+        Surfaces s;
+        s.push_back(surface(0, nullptr));
+        return s;
+      })()},
       program{([&] {
-        auto b = window.Bind();  // bind gl for scope
-        auto vshader =
-            std::ifstream("src/renderer/renderers/gl/shaders/triangle.vert");
-        auto fshader =
-            std::ifstream("src/renderer/renderers/gl/shaders/triangle.frag");
+        auto b = surfaces.front()->Bind();  // bind gl for scope
         return ProgramBuilder()
-            .AddVertexShader(&vshader)
-            .AddFragmentShader(&fshader)
+            .Cache(programCache())
+            .AddVertexShader(shaders::kTriangleVert)
+            .AddFragmentShader(shaders::kTriangleFrag)
             .Build();
       })()},
-      mvpHandle{([&] {
-        auto b = window.Bind();
-        return program->UniformLocation("model_view_projection");
-      })()},
+      schedule{s},
       renderFunc(renderf) {
-  window.Swapiness(0);
+  // The first surface's context is shared with the rest, which are created
+  // while the driver compiles the program
+  for (size_t i = 1; i < views; i++) {
+    surfaces.push_back(surface(i, surfaces.front().get()));
+  }
+  for (auto &s : surfaces) {
+    s->Swapiness(schedule.Swapiness());
+  }
 }
 
 void RenderThread::Run() {
   for (;;) {
-    if (!Render(renderFunc(&window, mvpHandle))) {
+    schedule.Wait();
+    auto draw = false, open = false;
+    {
+      RenderPasses renders{&arena};
+      draw = renderFunc(surfaces, &renders);
+      open = Render(draw, &renders);
+    }
+    // Every pass is gone, so the frame's memory can be reused
+    arena.Reset();
+    if (!open) {
       return;
     }
+    if (draw) {
+      schedule.Presented();
+    }
   }
 }
 
-bool RenderThread::Render(std::vector<RenderPass> renders) {
-  auto b = window.Bind();
+bool RenderThread::Render(bool draw, RenderPasses *renders) {
+  auto report = draw && ++drawn % kReportFrames == 0;
+  uint64_t issued = 0, skipped = 0;
+  for (size_t v = 0; draw && v < surfaces.size(); v++) {
+    auto &surface = surfaces[v];
+    if (surface == nullptr) {
+      continue;
+    }
+    auto b = surface->Bind();
+    if (mvpHandle == -1) {
+      // Only now, with the first frame prepared, is the link waited on
+      mvpHandle = program->UniformLocation("model_view_projection");
+    }
+
+    // pre-rendering; unchanged state is skipped
+    auto state = State::Current();
+    state->Enable(GL_DEPTH_TEST);
+    state->DepthFunc(GL_LESS);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    program->Use();
 
-  // pre-rendering
-  glEnable(GL_DEPTH_TEST);
-  glDepthFunc(GL_LESS);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  program->Use();
+    for (auto &r : *renders) {
+      r.Render(v, mvpHandle, Buffers(*r.Geometry()));
+    }
 
-  for (auto &r : renders) {
-    r.Render();
+    surface->Swap();
+    if (report) {
+      issued += state->Issued();
+      skipped += state->Skipped();
+    }
+  }
+  if (report) {
+    std::clog << "gl::RenderThread: " << drawn << " frames drawn at "
+              << schedule.Stats().Mean() << " fps, " << issued
+              << " state changes and context switches issued and " << skipped
+              << " skipped as redundant" << std::endl;
   }
 
-  window.Swap();
-  glfwPollEvents();
-  if (window.Key(GLFW_KEY_ESCAPE) == GLFW_PRESS || window.ShouldClose()) {
-    return false;
+  auto open = false;
+  for (auto &surface : surfaces) {
+    if (surface != nullptr && surface->Closed()) {
+      surface.reset();
+    }
+    open |= surface != nullptr;
+  }
+  return open;
+}
+
+void RenderThread::Upload(const Mesh &m) {
+  for (auto &surface : surfaces) {
+    if (surface != nullptr) {
+      auto b = surface->Bind();
+      Buffers(m);
+      return;
+    }
+  }
+}
+
+MeshBuffers *RenderThread::Buffers(const Mesh &m) {
+  auto id = m.Id();
+  if (meshes.size() <= id) {
+    meshes.resize(id + 1);
+  }
+  if (meshes[id] == nullptr) {
+    meshes[id].reset(new MeshBuffers{m});
   }
-  return true;
+  return meshes[id].get();
 }
 
 Renderer::Renderer(
-    std::shared_ptr<renderer::Renderable> v,
-    std::function<std::shared_ptr<renderer::Renderable>(size_t w, size_t h)> p)
-    : view{v}, projection{p}, renderThread{[&] {
-        renderer::Timer::Start();
-        renderer = new RenderThread{[&](Window *win, GLint mvpHandle) {
-          renderer::Timer::Instance()->Stop();
-          // Do rendering
-          std::vector<RenderPass> renders;
-          {
-            std::unique_lock<std::mutex> lock(displayLock);
-            displayCondition.wait(lock, [&] { return display.size() > 0; });
-            for (auto m : ([&] {
-                   std::map<std::shared_ptr<Rasterizable>, std::vector<size_t>>
-                       map;
-                   for (size_t i = 0; i < display.size(); i++) {
-                     map[display[i]].push_back(i);
-                   }
-                   return map;
-                 })()) {
-              renders.push_back({m.first, m.second, view,
-                                 projection(static_cast<uint>(win->Width()),
-                                            static_cast<uint>(win->Height())),
-                                 model, mvpHandle});
+    std::vector<std::shared_ptr<renderer::Renderable>> v,
+    std::function<std::shared_ptr<renderer::Renderable>(size_t w, size_t h)> p,
+    SurfaceFactory s, renderer::Schedule sc, renderer::Clock c)
+    : views{v},
+      projection{p},
+      surface{s},
+      schedule{sc},
+      clock{c},
+      renderThread{[&] {
+        // Snapshot generation and surface sizes last drawn
+        uint64_t drawn = 0;
+        std::vector<std::pair<int, int>> drawnSizes;
+        // Each view's projection, made again only when its size changes
+        std::vector<std::shared_ptr<renderer::Renderable>> projections(
+            views.size());
+        std::vector<std::pair<int, int>> projected(views.size());
+        renderer.reset(new RenderThread{views.size(), surface, schedule, [&](
+                                        const Surfaces &surfaces,
+                                        RenderPasses *out) {
+          auto arena = out->get_allocator().resource();
+          std::pmr::vector<std::pair<int, int>> sizes{arena};
+          sizes.reserve(surfaces.size());
+          for (auto &s : surfaces) {
+            sizes.push_back(s == nullptr ? std::make_pair(0, 0)
+                                         : std::make_pair(s->Width(),
+                                                          s->Height()));
+          }
+          // Events handled since the last frame are applied first
+          loop.Drain();
+          auto unchanged = [&] {
+            return scene.Latest()->Generation() == drawn &&
+                   std::equal(sizes.begin(), sizes.end(), drawnSizes.begin(),
+                              drawnSizes.end());
+          };
+          if (schedule.Pace() == renderer::Schedule::Mode::kOnChange) {
+            // Only a newer snapshot, a resize or animation needs a frame
+            if (animated.empty() && unchanged()) {
+              loop.Wait(schedule.Idle());
+              if (animated.empty() && unchanged()) {
+                return false;
+              }
+            }
+          } else {
+            // Render the latest snapshot, waiting for the first spawn
+            while (scene.Latest()->Generation() == 0) {
+              loop.Wait();
+            }
+          }
+          auto snapshot = scene.Latest();
+          drawn = snapshot->Generation();
+          drawnSizes.assign(sizes.begin(), sizes.end());
+          // Every renderable is evaluated at the same time for the frame
+          auto frame = clock.Tick();
+
+          auto &renders = *out;
+          std::pmr::vector<glm::mat4> vps(surfaces.size(), glm::mat4(1.0),
+                                          arena);
+          for (size_t v = 0; v < surfaces.size(); v++) {
+            if (surfaces[v] == nullptr) {
+              continue;
+            }
+            if (projections[v] == nullptr || projected[v] != sizes[v]) {
+              projections[v] =
+                  projection(static_cast<uint>(sizes[v].first),
+                             static_cast<uint>(sizes[v].second));
+              projected[v] = sizes[v];
             }
+            apply(*projections[v], frame, &vps[v]);
+            apply(*views[v], frame, &vps[v]);
           }
-          return renders;
-        }};
+          // Objects are grouped by mesh as they are spawned
+          renders.reserve(snapshot->Groups());
+          for (size_t i = 0; i < snapshot->Groups(); i++) {
+            if ((*snapshot)[i].Size() > 0) {
+              if (grids.size() <= i) {
+                grids.resize(i + 1);
+              }
+              if (grids[i] == nullptr) {
+                grids[i].reset(new renderer::Grid{});
+              }
+              renders.emplace_back(snapshot, i, frame, vps, grids[i].get(),
+                                   arena);
+            }
+          }
+
+          // Run f for every job of every pass on the spool's workers
+          auto parallel = [&](auto f) {
+            std::pmr::vector<std::pair<size_t, size_t>> jobs{arena};
+            for (size_t i = 0; i < renders.size(); i++) {
+              for (size_t j = 0; j < renders[i].Jobs(); j++) {
+                jobs.push_back({i, j});
+              }
+            }
+            Spool::Instance()->Parallel(jobs.size(), [&](size_t i) {
+              f(&renders[jobs[i].first], jobs[i].second);
+            });
+          };
+          // Transforms are computed once per frame for every view
+          parallel([](RenderPass *r, size_t j) { r->Prepare(j); });
+          for (auto &r : renders) {
+            r.Bin();
+          }
+          parallel([](RenderPass *r, size_t j) { r->Place(j); });
+          for (auto &r : renders) {
+            r.Refit();
+          }
+
+          // Then culled per live view
+          std::pmr::vector<std::pair<size_t, size_t>> culls{arena};
+          for (size_t i = 0; i < renders.size(); i++) {
+            for (size_t v = 0; v < surfaces.size(); v++) {
+              if (surfaces[v] != nullptr) {
+                culls.push_back({i, v});
+              }
+            }
+          }
+          Spool::Instance()->Parallel(culls.size(), [&](size_t i) {
+            renders[culls[i].first].Cull(culls[i].second);
+          });
+          return true;
+        }});
         renderer->Run();
-      }} {
-  if (display.size() != model.size()) {
-    throw std::runtime_error(static_cast<std::stringstream &>(
-                                 std::stringstream()
-                                 << "gl::Renderer: Display and model vectors "
-                                    "must be the same size, "
-                                 << display.size() << " != " << model.size())
-                                 .str());
-  }
-}
+        // Every view has closed, so drop the events nothing will handle,
+        // release the views and their output, flushing the frames it is
+        // still writing, and end the run
+        loop.Close();
+        renderer = nullptr;
+        surface = nullptr;
+        Spool::Instance()->Handle(std::shared_ptr<Event>{
+            new events::Terminate{"gl::Renderer: every view closed"}});
+      }} {}
 
 std::unique_ptr<renderer::shapes::Factory> Renderer::ShapeFactory() {
   return std::unique_ptr<renderer::shapes::Factory>(new shapes::Factory());
@@ -200,20 +425,59 @@ std::unique_ptr<renderer::shapes::Factory> Renderer::ShapeFactory() {
 void Renderer::Handle(std::shared_ptr<Event> const e) {
   ([&](std::shared_ptr<event::Spawn> spawn) {
     if (spawn != nullptr) {
-      auto d = std::dynamic_pointer_cast<Rasterizable>(spawn->Display());
-      if (d == nullptr) {
-        // TODO(cptaffe): throw rejection event
-        throw std::runtime_error(
-            "gl::Renderer.Handle: Spawn event contains .Display "
-            "renderer::Rasterizable which does not "
-            "inherit from gl::Rasterizable");
+      // Geometry is interned so objects are grouped by mesh id
+      auto mesh = Registry::Instance()->Intern(spawn->Display());
+      auto model = renderer::Chain(spawn->Model());
+      if (model->Animated()) {
+        animated[spawn->Id().index] = spawn->Id().generation;
       }
-      std::unique_lock<std::mutex> lock(displayLock);
-      model.push_back(spawn->Model());
-      display.push_back(std::shared_ptr<Rasterizable>(d));
-      displayCondition.notify_one();
+      renderer->Upload(*mesh);
+      scene.Append(mesh->Id(), Object{mesh, model}, spawn->Id());
     }
   })(std::dynamic_pointer_cast<event::Spawn>(e));
+  ([&](std::shared_ptr<event::SpawnBatch> batch) {
+    if (batch != nullptr) {
+      std::vector<std::pair<size_t, Object>> objects;
+      std::vector<renderer::Handle> handles;
+      objects.reserve(batch->Records().size());
+      handles.reserve(batch->Records().size());
+      // Runs of records usually share geometry, so intern once per run
+      std::shared_ptr<renderer::Rasterizable> display;
+      std::shared_ptr<Mesh> mesh;
+      for (auto &r : batch->Records()) {
+        if (r.display != display) {
+          display = r.display;
+          mesh = Registry::Instance()->Intern(display);
+          renderer->Upload(*mesh);
+        }
+        if (r.model->Animated()) {
+          animated[r.handle.index] = r.handle.generation;
+        }
+        objects.push_back({mesh->Id(), Object{mesh, r.model}});
+        handles.push_back(r.handle);
+      }
+      scene.Append(std::move(objects), handles);
+    }
+  })(std::dynamic_pointer_cast<event::SpawnBatch>(e));
+  ([&](std::shared_ptr<event::Despawn> despawn) {
+    if (despawn != nullptr) {
+      // Last instances move into the holes; the grid rebins them as moved
+      scene.Remove(despawn->Handles());
+      for (auto h : despawn->Handles()) {
+        auto a = animated.find(h.index);
+        if (a != animated.end() && a->second <= h.generation) {
+          animated.erase(a);
+        }
+      }
+    }
+  })(std::dynamic_pointer_cast<event::Despawn>(e));
+  ([&](std::shared_ptr<event::View> view) {
+    if (view != nullptr && view->Index() < views.size()) {
+      views[view->Index()] = view->Camera();
+      // A new generation has the next frame drawn even if nothing animates
+      scene.Touch();
+    }
+  })(std::dynamic_pointer_cast<event::View>(e));
 }
 
 }  // namespace gl
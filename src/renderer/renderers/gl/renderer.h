@@ -3,76 +3,182 @@
 #ifndef SRC_RENDERER_RENDERERS_GL_RENDERER_H_
 #define SRC_RENDERER_RENDERERS_GL_RENDERER_H_
 
-#include <condition_variable>
+#include <atomic>
 #include <functional>
 #include <memory>
-#include <mutex>
+#include <memory_resource>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "src/renderer/arena.h"
+#include "src/renderer/clock.h"
+#include "src/renderer/cull.h"
 #include "src/renderer/renderer.h"
+#include "src/renderer/scene.h"
+#include "src/renderer/schedule.h"
+#include "src/renderer/renderers/gl/mesh.h"
 #include "src/renderer/renderers/gl/shader.h"
 #include "src/renderer/renderers/gl/shapes.h"
-#include "src/renderer/renderers/gl/window.h"
+#include "src/renderer/renderers/gl/surface.h"
+#include "src/runloop.h"
 #include "src/spool.h"
 
 namespace gl {
 
 class Renderer;
 
+// A spawned mesh and the model transforms placing it
+struct Object {
+  std::shared_ptr<Mesh> mesh;
+  std::shared_ptr<renderer::Renderable> model;
+};
+
+using Scene = renderer::Scene<Object>;
+
+// A renderer's surfaces, one per view
+using Surfaces = std::vector<std::unique_ptr<Surface>>;
+
+// Creates the surface of a view, sharing objects with share's context
+using SurfaceFactory =
+    std::function<std::unique_ptr<Surface>(size_t view, const Surface *share)>;
+
 class RenderPass {
  public:
-  RenderPass(std::shared_ptr<Rasterizable> rend, std::vector<size_t> ind,
-             std::shared_ptr<renderer::Renderable> view,
-             std::shared_ptr<renderer::Renderable> projection,
-             const std::vector<
-                 std::vector<std::shared_ptr<renderer::Renderable>>> &model,
-             GLint h);
-  void Render();
+  // Draws the visible instances of one of the snapshot's mesh groups into
+  // every view at frame's time, using grid as the group's persistent
+  // spatial index. Model matrices and the grid are shared by all views; only
+  // the view-projection in vps and the culling differ. The pass's buffers
+  // are allocated from the frame's arena.
+  RenderPass(std::shared_ptr<const Scene::Snapshot> snapshot, size_t group,
+             renderer::Frame frame, const std::pmr::vector<glm::mat4> &vps,
+             renderer::Grid *grid, std::pmr::memory_resource *arena);
+  // Number of jobs Prepare and Place split this pass's instances into
+  size_t Jobs() const;
+  // Compute model matrices for one job's instances,
+  // safe to call concurrently for distinct jobs.
+  void Prepare(size_t job);
+  // Lay out the prepared instances, one run per job, and size the grid
+  void Bin();
+  // Copy one job's prepared instances into place and update their grid
+  // positions, safe to call concurrently for distinct jobs.
+  void Place(size_t job);
+  // Rebin instances which changed cells
+  void Refit();
+  // Compute the model-view-projection matrices of the instances not culled
+  // by a view's frustum, safe to call concurrently for distinct views.
+  void Cull(size_t view);
+  // Draw the instances a view kept, into the matrix uniform at mvp
+  void Render(size_t view, GLint mvp, MeshBuffers *buffers);
+  std::shared_ptr<gl::Mesh> Geometry() const { return mesh; }
 
  private:
-  std::shared_ptr<Rasterizable> rasterizable;
-  std::vector<size_t> indices;
-  std::vector<GLfloat> colors, vertices;
-  GLint mvpHandle;
-  std::vector<glm::mat4> mvp;
+  std::shared_ptr<const Scene::Snapshot> snapshot;
+  const Scene::Group &group;
+  std::shared_ptr<gl::Mesh> mesh;
+  renderer::Frame frame;
+  std::pmr::vector<glm::mat4> viewProjections;
+  renderer::Grid *grid;
+  std::pmr::vector<std::pmr::vector<glm::mat4>> jobs;
+  // Returns the models' storage to the resource it came from
+  struct Release {
+    std::pmr::memory_resource *resource;
+    size_t n;
+    void operator()(glm::mat4 *p) const {
+      resource->deallocate(p, n * sizeof(glm::mat4), alignof(glm::mat4));
+    }
+  };
+  // Model matrices of every instance, uninitialized until each job's are
+  // placed, and each job's first instance
+  std::unique_ptr<glm::mat4[], Release> models;
+  std::pmr::vector<size_t> offsets;
+  // Per job, instances which left their cell and their largest radius
+  std::pmr::vector<std::pmr::vector<size_t>> moved;
+  std::pmr::vector<float> radii;
+  // Per view, matrices of the instances which survived culling
+  std::pmr::vector<std::pmr::vector<glm::mat4>> mvp;
 };
 
+// A frame's passes, allocated from its arena
+using RenderPasses = std::pmr::vector<RenderPass>;
+
 class RenderThread {
  public:
-  RenderThread(
-      std::function<std::vector<RenderPass>(Window *, GLint)> renderFunc);
+  // Renders into one surface per view, paced by schedule. Surfaces share a
+  // context group, so the program and mesh buffers exist once for all of
+  // them. renderf prepares a frame's passes, returning false if there is no
+  // new frame to draw; anything it allocates for the frame should come from
+  // the passes' arena, which is reset once the frame is drawn. The program
+  // links while the surfaces are made and the first frame is prepared.
+  RenderThread(size_t views, SurfaceFactory surface,
+               renderer::Schedule schedule,
+               std::function<bool(const Surfaces &, RenderPasses *)> renderf);
   void Run();
+  // Upload a mesh's buffers ahead of its first draw
+  void Upload(const Mesh &m);
 
  private:
-  gl::Window window;
+  // Null once closed
+  Surfaces surfaces;
   std::shared_ptr<Program> program;
-  GLint mvpHandle;
-  std::function<std::vector<RenderPass>(Window *, GLint)> renderFunc;
+  // Found once the program has linked, when the first frame is drawn
+  GLint mvpHandle = -1;
+  renderer::Schedule schedule;
+  std::function<bool(const Surfaces &, RenderPasses *)> renderFunc;
+  // Temporaries of the frame being drawn
+  renderer::Arena arena;
+  // Buffers of every mesh drawn so far in the context group, by mesh id
+  std::vector<std::unique_ptr<MeshBuffers>> meshes;
+  // Frames drawn so far
+  uint64_t drawn = 0;
 
-  bool Render(std::vector<RenderPass> renders);
+  // Draw the passes if draw, then poll the surfaces, returning whether any
+  // are still open. Every thousand frames, logs how many of the surfaces'
+  // state changes were redundant.
+  bool Render(bool draw, RenderPasses *renders);
+  // Buffers of a mesh, uploaded with the current surface if need be
+  MeshBuffers *Buffers(const Mesh &m);
 };
 
+// Renders one scene into a surface per view. Events are handled on the
+// render thread between frames, so the scene is only touched by that thread
+// and meshes are uploaded as they are spawned.
 class Renderer : public renderer::Renderer {
  public:
   Renderer(
-      std::shared_ptr<renderer::Renderable> v,
-      std::function<std::shared_ptr<renderer::Renderable>(size_t, size_t)>);
+      std::vector<std::shared_ptr<renderer::Renderable>> v,
+      std::function<std::shared_ptr<renderer::Renderable>(size_t, size_t)>,
+      SurfaceFactory s,
+      renderer::Schedule sc = renderer::Schedule::Unlimited(),
+      renderer::Clock c = renderer::Clock::Real());
   ~Renderer() {}
   std::unique_ptr<renderer::shapes::Factory> ShapeFactory() override;
   void Render() override {}
   void Handle(std::shared_ptr<Event> const e) override;
+  Executor *Affinity() override { return &loop; }
 
  private:
-  std::shared_ptr<renderer::Renderable> view;
+  // Each view's camera, replaced by View events
+  std::vector<std::shared_ptr<renderer::Renderable>> views;
   std::function<std::shared_ptr<renderer::Renderable>(size_t w, size_t h)>
       projection;
-  std::vector<std::vector<std::shared_ptr<renderer::Renderable>>> model;
-  std::mutex displayLock;
-  std::condition_variable displayCondition;
-  std::vector<std::shared_ptr<Rasterizable>> display;
+  SurfaceFactory surface;
+  renderer::Schedule schedule;
+  // Render thread only
+  renderer::Clock clock;
+  // Only touched by the render thread, so never copied
+  Scene scene{false};
+  // Generation of each animated object by handle index, kept until it is
+  // despawned; while any are left every frame needs redrawing
+  std::unordered_map<uint32_t, uint32_t> animated;
+  // Spatial index of each mesh's instances, by mesh id; render thread only
+  std::vector<std::unique_ptr<renderer::Grid>> grids;
+  // Events for the render thread, drained before each frame
+  RunLoop loop;
+  // Made and destroyed by the render thread, as its contexts live there;
+  // declared first so it is initialized before that thread starts
+  std::unique_ptr<RenderThread> renderer;
   std::thread renderThread;
-  RenderThread *renderer = nullptr;
 };
 
 }  // namespace gl
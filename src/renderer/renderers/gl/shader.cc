@@ -2,6 +2,14 @@
 
 #include "src/renderer/renderers/gl/shader.h"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <map>
@@ -12,50 +20,129 @@ namespace gl {
 
 namespace {
 
-void compileShaders(const GLuint &programHandle,
-                    const std::map<GLuint, std::string> &shaders) {
-  // Error checking wrapper function
-  auto check = [=](void (*f)(GLuint, GLenum, GLint *),
-                   void (*l)(GLenum, GLsizei, GLsizei *, GLchar *),
-                   GLenum status, GLuint handle, std::string err) {
-    GLint res;
-    f(handle, status, &res);
-    GLsizei ll;
-    f(handle, GL_INFO_LOG_LENGTH, &ll);
-    if (res == GL_FALSE) {
-      std::vector<char> v(static_cast<size_t>(ll) + 1);
-      l(handle, ll + 1, &ll, v.data());
-      throw std::runtime_error(err + ": " +
-                               std::string(reinterpret_cast<const char *>(
-                                   gluErrorString(glGetError()))) +
-                               ", " + std::string(v.begin(), v.end()));
+// Throw err with the handle's info log if its status is false
+void check(void (*f)(GLuint, GLenum, GLint *),
+           void (*l)(GLenum, GLsizei, GLsizei *, GLchar *), GLenum status,
+           GLuint handle, std::string err) {
+  GLint res;
+  f(handle, status, &res);
+  GLsizei ll;
+  f(handle, GL_INFO_LOG_LENGTH, &ll);
+  if (res == GL_FALSE) {
+    std::vector<char> v(static_cast<size_t>(ll) + 1);
+    l(handle, ll + 1, &ll, v.data());
+    throw std::runtime_error(err + ": " +
+                             std::string(reinterpret_cast<const char *>(
+                                 gluErrorString(glGetError()))) +
+                             ", " + std::string(v.begin(), v.end()));
+  }
+}
+
+// Whether the driver can save and load program binaries
+bool binaries() {
+  if (!GLEW_ARB_get_program_binary) {
+    return false;
+  }
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
+
+// Binaries are only valid for the driver which produced them, so the key
+// covers the driver as well as the sources
+std::string cacheKey(const std::map<GLuint, std::string> &shaders) {
+  uint64_t h = 14695981039346656037ull;
+  auto mix = [&](const void *p, size_t len) {
+    auto b = static_cast<const unsigned char *>(p);
+    for (size_t i = 0; i < len; i++) {
+      h = (h ^ b[i]) * 1099511628211ull;
     }
   };
-
+  for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    auto str = reinterpret_cast<const char *>(glGetString(name));
+    mix(str, std::strlen(str) + 1);
+  }
   for (auto s : shaders) {
-    auto sc = s.second.c_str();
-    glShaderSource(s.first, 1, &sc, nullptr);
-    glCompileShader(s.first);
-    check(glGetShaderiv, glGetShaderInfoLog, GL_COMPILE_STATUS, s.first,
-          "error compiling shader");
-    glAttachShader(programHandle, s.first);
+    GLint type;
+    glGetShaderiv(s.first, GL_SHADER_TYPE, &type);
+    mix(&type, sizeof(type));
+    mix(s.second.c_str(), s.second.size() + 1);
   }
+  std::stringstream key;
+  key << std::hex << std::setw(16) << std::setfill('0') << h;
+  return key.str();
+}
 
-  glLinkProgram(programHandle);
-  check(glGetProgramiv, glGetProgramInfoLog, GL_LINK_STATUS, programHandle,
-        "error linking program");
+// Load a cached binary into program, returning whether it linked. Binaries
+// the driver no longer accepts, e.g. after an update, are simply rebuilt.
+bool load(GLuint program, const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  GLenum format;
+  if (!in.read(reinterpret_cast<char *>(&format), sizeof(format))) {
+    return false;
+  }
+  std::vector<char> binary{std::istreambuf_iterator<char>{in},
+                           std::istreambuf_iterator<char>{}};
+  glProgramBinary(program, format, binary.data(),
+                  static_cast<GLsizei>(binary.size()));
+  GLint linked;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  return linked == GL_TRUE;
 }
 
-void deleteShaders(const GLuint &programHandle,
-                   const std::map<GLuint, std::string> &shaders) {
-  for (auto s : shaders) {
-    glDetachShader(programHandle, s.first);
-    glDeleteShader(s.first);
+// Save program's binary to path, creating its directory if needed
+void save(GLuint program, const std::string &path) {
+  for (auto i = path.find('/', 1); i != std::string::npos;
+       i = path.find('/', i + 1)) {
+    mkdir(path.substr(0, i).c_str(), 0755);
+  }
+  GLint length;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  std::vector<char> binary(static_cast<size_t>(length));
+  GLenum format;
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+  // Written aside and renamed so concurrent processes never read a partial
+  // binary; failing to cache is not an error
+  auto tmp = path + "." + std::to_string(getpid());
+  {
+    std::ofstream out(tmp, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(&format), sizeof(format));
+    out.write(binary.data(), length);
+    if (!out) {
+      std::remove(tmp.c_str());
+      return;
+    }
   }
+  std::rename(tmp.c_str(), path.c_str());
 }
 
 }  // namespace
 
+void Program::Link() {
+  if (shaders.empty()) {
+    return;
+  }
+  GLint linked;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (linked == GL_FALSE) {
+    // Report the shader which failed to compile, if any
+    for (auto s : shaders) {
+      check(glGetShaderiv, glGetShaderInfoLog, GL_COMPILE_STATUS, s,
+            "error compiling shader");
+    }
+    check(glGetProgramiv, glGetProgramInfoLog, GL_LINK_STATUS, program,
+          "error linking program");
+  }
+  if (!cache.empty()) {
+    save(program, cache);
+  }
+  for (auto s : shaders) {
+    glDetachShader(program, s);
+    glDeleteShader(s);
+  }
+  shaders.clear();
+}
+
 ProgramBuilder::ProgramBuilder() : programHandle(glCreateProgram()) {
   if (!([=] {
         GLboolean support;
@@ -64,6 +151,12 @@ ProgramBuilder::ProgramBuilder() : programHandle(glCreateProgram()) {
       })()) {
     throw std::runtime_error("no shader support");
   }
+#ifdef GL_KHR_parallel_shader_compile
+  if (GLEW_KHR_parallel_shader_compile) {
+    // Let the driver choose how many threads compile shaders
+    glMaxShaderCompilerThreadsKHR(0xffffffff);
+  }
+#endif
 }
 
 ProgramBuilder ProgramBuilder::AddVertexShader(std::istream *src) {
@@ -86,10 +179,37 @@ ProgramBuilder ProgramBuilder::AddFragmentShader(std::string src) {
   return *this;
 }
 
+ProgramBuilder ProgramBuilder::Cache(std::string dir) {
+  cacheDir = dir;
+  return *this;
+}
+
 std::shared_ptr<Program> ProgramBuilder::Build() {
-  compileShaders(programHandle, shaders);
-  deleteShaders(programHandle, shaders);
-  return std::unique_ptr<Program>{new Program{programHandle}};
+  std::string path;
+  if (!cacheDir.empty() && binaries()) {
+    path = cacheDir + "/" + cacheKey(shaders) + ".bin";
+    if (load(programHandle, path)) {
+      for (auto s : shaders) {
+        glDeleteShader(s.first);
+      }
+      return std::shared_ptr<Program>{
+          new Program{programHandle, std::vector<GLuint>{}, ""}};
+    }
+    glProgramParameteri(programHandle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+
+  // Status is not queried here, since querying waits for the compiler
+  std::vector<GLuint> handles;
+  for (auto s : shaders) {
+    auto sc = s.second.c_str();
+    glShaderSource(s.first, 1, &sc, nullptr);
+    glCompileShader(s.first);
+    glAttachShader(programHandle, s.first);
+    handles.push_back(s.first);
+  }
+  glLinkProgram(programHandle);
+  return std::shared_ptr<Program>{new Program{programHandle, handles, path}};
 }
 
 }  // namespace gl
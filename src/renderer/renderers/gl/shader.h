@@ -13,15 +13,28 @@
 #include <string>
 #include <vector>
 
+#include "src/renderer/renderers/gl/state.h"
+
 namespace gl {
 
 class Program {
  public:
-  explicit Program(GLuint p) : program(p) {}
   Program(const Program &) = delete;
-  ~Program() { glDeleteProgram(program); }
-  void Use() { glUseProgram(program); }
+  ~Program() {
+    glDeleteProgram(program);
+    State::Released();
+  }
+  void Use() {
+    Link();
+    auto s = State::Current();
+    if (s != nullptr) {
+      s->UseProgram(program);
+    } else {
+      glUseProgram(program);
+    }
+  }
   GLint UniformLocation(std::string s) {
+    Link();
     auto u = glGetUniformLocation(program, s.c_str());
     if (u == -1) {
       throw std::runtime_error(static_cast<std::stringstream &>(
@@ -34,7 +47,19 @@ class Program {
   }
 
  private:
+  friend class ProgramBuilder;
+  Program(GLuint p, std::vector<GLuint> s, std::string c)
+      : program{p}, shaders{s}, cache{c} {}
+
+  // Wait for the link, throwing on errors, then save the binary to the cache
+  // and free the shaders
+  void Link();
+
   GLuint program;
+  // Shaders still being compiled and linked; empty once linked
+  std::vector<GLuint> shaders;
+  // Where the linked binary is saved, if anywhere
+  std::string cache;
 };
 
 class ProgramBuilder {
@@ -45,11 +70,17 @@ class ProgramBuilder {
   ProgramBuilder AddVertexShader(std::string src);
   ProgramBuilder AddFragmentShader(std::istream *src);
   ProgramBuilder AddFragmentShader(std::string src);
+  // Load and save linked program binaries in directory dir, keyed by the
+  // driver and the shader sources
+  ProgramBuilder Cache(std::string dir);
+  // Start compiling and linking, or load a cached binary. Errors are
+  // reported once the program is first used.
   std::shared_ptr<Program> Build();
 
  private:
   GLuint programHandle;
   std::map<GLuint, std::string> shaders;
+  std::string cacheDir;
 };
 
 }  // namespace gl
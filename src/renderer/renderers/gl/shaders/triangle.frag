@@ -1,8 +0,0 @@
-#version 330 core
-
-in vec3 fragColor;
-out vec3 color;
-
-void main() {
-  color = fragColor;
-}
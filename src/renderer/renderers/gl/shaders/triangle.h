@@ -0,0 +1,40 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_RENDERERS_GL_SHADERS_TRIANGLE_H_
+#define SRC_RENDERER_RENDERERS_GL_SHADERS_TRIANGLE_H_
+
+namespace gl {
+namespace shaders {
+
+// Instanced, per-vertex colored triangles. Compiled into the binary so the
+// renderer does not depend on the working directory.
+const char kTriangleVert[] = R"glsl(
+#version 330 core
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec3 color;
+
+out vec3 fragColor;
+
+uniform mat4 model_view_projection[1024];
+
+void main() {
+  fragColor = color;
+  gl_Position = model_view_projection[gl_InstanceID] * vec4(pos, 1);
+})glsl";
+
+const char kTriangleFrag[] = R"glsl(
+#version 330 core
+
+in vec3 fragColor;
+out vec3 color;
+
+void main() {
+  color = fragColor;
+})glsl";
+
+}  // namespace shaders
+}  // namespace gl
+
+#endif  // SRC_RENDERER_RENDERERS_GL_SHADERS_TRIANGLE_H_
@@ -15,10 +15,8 @@ namespace gl {
 class Rasterizable : public renderer::Rasterizable {
  public:
   virtual ~Rasterizable();
-  virtual void Rasterize(std::vector<GLfloat> *b) const = 0;
-  virtual GLenum Type() = 0;
-  friend bool operator<(std::shared_ptr<gl::Rasterizable>,
-                        std::shared_ptr<gl::Rasterizable>);
+  // Primitive mode the indices are drawn with
+  virtual GLenum Type() const = 0;
 };
 
 namespace shapes {
@@ -30,7 +28,4 @@ class Factory : public renderer::shapes::Factory {
 }  // namespace shapes
 }  // namespace gl
 
-bool operator<(std::shared_ptr<gl::Rasterizable>,
-               std::shared_ptr<gl::Rasterizable>);
-
 #endif  // SRC_RENDERER_RENDERERS_GL_SHAPES_H_
@@ -0,0 +1,86 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/renderers/gl/state.h"
+
+#include <atomic>
+
+namespace gl {
+
+namespace {
+
+// Bumped whenever an object is deleted in any context
+std::atomic<uint64_t> releases{0};
+
+}  // namespace
+
+thread_local State *State::current = nullptr;
+
+State *State::MakeCurrent(State *s) {
+  auto previous = current;
+  current = s;
+  return previous;
+}
+
+void State::Released() { releases++; }
+
+bool State::Count(bool needed) {
+  if (needed) {
+    issued++;
+  } else {
+    skipped++;
+  }
+  return needed;
+}
+
+void State::Refresh() {
+  auto r = releases.load();
+  if (r != released) {
+    released = r;
+    program = 0;
+    attributes = 0;
+    buffers.clear();
+  }
+}
+
+void State::Enable(GLenum cap) {
+  auto e = enabled.find(cap);
+  if (Count(e == enabled.end() || !e->second)) {
+    glEnable(cap);
+    enabled[cap] = true;
+  }
+}
+
+void State::DepthFunc(GLenum func) {
+  if (Count(depthFunc != func)) {
+    glDepthFunc(func);
+    depthFunc = func;
+  }
+}
+
+void State::UseProgram(GLuint p) {
+  Refresh();
+  if (Count(program != p)) {
+    glUseProgram(p);
+    program = p;
+  }
+}
+
+void State::BindBuffer(GLenum target, GLuint buffer) {
+  Refresh();
+  auto b = buffers.find(target);
+  if (Count(b == buffers.end() || b->second != buffer)) {
+    glBindBuffer(target, buffer);
+    buffers[target] = buffer;
+  }
+}
+
+bool State::PointAttributes(GLuint buffer) {
+  Refresh();
+  if (Count(attributes != buffer)) {
+    attributes = buffer;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace gl
@@ -0,0 +1,62 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_RENDERERS_GL_STATE_H_
+#define SRC_RENDERER_RENDERERS_GL_STATE_H_
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <map>
+
+namespace gl {
+
+// Shadow of one context's state, so calls which would not change it are
+// skipped. Binding a surface makes its context's State current on the
+// calling thread; a State is only used while its context is current.
+class State {
+ public:
+  State() {}
+  State(const State &) = delete;
+
+  // State of the context current on this thread, or null
+  static State *Current() { return current; }
+  // Make s current on this thread, returning the previously current State
+  static State *MakeCurrent(State *s);
+
+  // Forget every context's bindings after objects are deleted, since their
+  // names may be reused for new objects
+  static void Released();
+
+  void Enable(GLenum cap);
+  void DepthFunc(GLenum func);
+  void UseProgram(GLuint program);
+  void BindBuffer(GLenum target, GLuint buffer);
+  // Whether the vertex attributes must be pointed at array buffer buffer;
+  // they are assumed to point at it afterwards
+  bool PointAttributes(GLuint buffer);
+  // Record a context switch, or one skipped as the context was current
+  void Switch(bool needed) { Count(needed); }
+
+  // State changes issued to GL and skipped as redundant
+  uint64_t Issued() const { return issued; }
+  uint64_t Skipped() const { return skipped; }
+
+ private:
+  static thread_local State *current;
+
+  // Count a change, returning whether it is needed
+  bool Count(bool needed);
+  // Drop bindings if objects were released since they were recorded
+  void Refresh();
+
+  uint64_t issued = 0, skipped = 0;
+  uint64_t released = 0;
+  std::map<GLenum, bool> enabled;
+  GLenum depthFunc = GL_LESS;
+  GLuint program = 0, attributes = 0;
+  std::map<GLenum, GLuint> buffers;
+};
+
+}  // namespace gl
+
+#endif  // SRC_RENDERER_RENDERERS_GL_STATE_H_
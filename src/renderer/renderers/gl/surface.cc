@@ -0,0 +1,11 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/renderers/gl/surface.h"
+
+namespace gl {
+
+Surface::~Surface() {}
+
+Surface::Binding::~Binding() { State::MakeCurrent(previous); }
+
+}  // namespace gl
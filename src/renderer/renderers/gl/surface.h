@@ -0,0 +1,44 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_RENDERERS_GL_SURFACE_H_
+#define SRC_RENDERER_RENDERERS_GL_SURFACE_H_
+
+#include <memory>
+
+#include "src/renderer/renderers/gl/state.h"
+
+namespace gl {
+
+// Something with a GL context to render into: a window or an offscreen
+// framebuffer
+class Surface {
+ public:
+  virtual ~Surface();
+
+  // Keeps the surface's context and its State current for its lifetime,
+  // restoring the previous State afterwards. Whether the previous context is
+  // restored too is up to the surface.
+  class Binding {
+   public:
+    virtual ~Binding();
+
+   protected:
+    explicit Binding(State *s) : previous{State::MakeCurrent(s)} {}
+
+   private:
+    State *previous;
+  };
+
+  virtual std::unique_ptr<Binding> Bind() const = 0;
+  virtual void Swapiness(int i) = 0;
+  // Present the frame just rendered
+  virtual void Swap() = 0;
+  // Process input, returning whether the surface should stop being rendered
+  virtual bool Closed() = 0;
+  virtual int Width() const = 0;
+  virtual int Height() const = 0;
+};
+
+}  // namespace gl
+
+#endif  // SRC_RENDERER_RENDERERS_GL_SURFACE_H_
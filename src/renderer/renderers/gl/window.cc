@@ -12,7 +12,7 @@ static thread_local bool glfw3Inited = false;
 }
 
 namespace gl {
-Window::Window(std::string title, int w, int h)
+Window::Window(std::string title, int w, int h, const Surface *share)
     : window{([&] {
         // HACK HACK HACK
         // glfwInit() should only be called from the main thread
@@ -43,7 +43,14 @@ Window::Window(std::string title, int w, int h)
 
         // Return creation function
         return &glfwCreateWindow;
-      })()(w, h, title.c_str(), nullptr, nullptr)} {
+      })()(w, h, title.c_str(), nullptr, ([&]() -> GLFWwindow * {
+             auto s = dynamic_cast<const Window *>(share);
+             if (share != nullptr && s == nullptr) {
+               throw std::runtime_error(
+                   "gl::Window: can only share a context with a Window");
+             }
+             return s == nullptr ? nullptr : s->window;
+           })())} {
   if (window == nullptr) {
     throw std::runtime_error("glfw create window failed");
   }
@@ -62,6 +69,7 @@ Window::Window(std::string title, int w, int h)
   if (glewInit() != GLEW_OK) {
     throw std::runtime_error("failed to initialize glew");
   }
+  vertexArray.reset(new VertexArray{});
   glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
 }
 Window::Window(GLFWwindow *const w) : window{w} {}
@@ -69,14 +77,12 @@ Window::Window(GLFWwindow *const w) : window{w} {}
 Window::~Window() { glfwDestroyWindow(window); }
 
 int Window::Width() const {
-  auto b = Bind();
   int width, height;
   glfwGetWindowSize(window, &width, &height);
   return width;
 }
 
 int Window::Height() const {
-  auto b = Bind();
   int width, height;
   glfwGetWindowSize(window, &width, &height);
   return height;
@@ -9,51 +9,61 @@
 #include <memory>
 #include <string>
 
+#include "src/renderer/renderers/gl/buffer.h"
+#include "src/renderer/renderers/gl/surface.h"
+
 namespace gl {
 
-class Window {
+class Window : public Surface {
  public:
-  Window(std::string title, int w, int h);
+  // Objects in share's context, if any, are shared with this window's;
+  // share must be another Window
+  Window(std::string title, int w, int h, const Surface *share = nullptr);
   explicit Window(GLFWwindow *const w);
   Window(const Window &other) = delete;
   ~Window();
 
-  class Binding {
+  // Switches context only if the window's is not already current, and
+  // leaves it current afterwards, so a thread drawing one window never
+  // switches and one drawing several switches once per window
+  class Binding : public Surface::Binding {
    public:
-    explicit Binding(GLFWwindow *n) : owin{glfwGetCurrentContext()} {
-      glfwMakeContextCurrent(n);
+    Binding(GLFWwindow *n, State *s) : Surface::Binding{s} {
+      auto switched = glfwGetCurrentContext() != n;
+      s->Switch(switched);
+      if (switched) {
+        glfwMakeContextCurrent(n);
+      }
     }
     Binding(const Binding &other) = delete;
-    ~Binding() { glfwMakeContextCurrent(owin); }
-
-   private:
-    GLFWwindow *owin;
   };
 
-  std::unique_ptr<Binding> Bind() const {
-    return std::unique_ptr<Binding>(new Binding(window));
-  }
-  bool ShouldClose() {
-    auto b = Bind();
-    return glfwWindowShouldClose(window);
+  std::unique_ptr<Surface::Binding> Bind() const override {
+    return std::unique_ptr<Surface::Binding>(new Binding(window, state.get()));
   }
-  int Key(int key) {
-    auto b = Bind();
-    return glfwGetKey(window, key);
-  }
-  void Swapiness(int i) {
+  // Window queries need no current context
+  bool ShouldClose() { return glfwWindowShouldClose(window); }
+  int Key(int key) { return glfwGetKey(window, key); }
+  void Swapiness(int i) override {
     auto b = Bind();
     glfwSwapInterval(i);
   }
-  void Swap() {
+  void Swap() override {
     auto b = Bind();
     glfwSwapBuffers(window);
   }
-  int Width() const;
-  int Height() const;
+  bool Closed() override {
+    glfwPollEvents();
+    return Key(GLFW_KEY_ESCAPE) == GLFW_PRESS || ShouldClose();
+  }
+  int Width() const override;
+  int Height() const override;
 
  private:
   GLFWwindow *const window;
+  std::unique_ptr<State> state{new State{}};
+  // Vertex arrays are per context, so each window binds its own
+  std::unique_ptr<VertexArray> vertexArray;
 };
 
 }  // namespace gl
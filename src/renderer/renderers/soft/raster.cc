@@ -0,0 +1,329 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/renderers/soft/raster.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace soft {
+
+namespace {
+
+// Sub-pixel precision vertices are snapped to, so that triangles sharing an
+// edge evaluate it identically
+const float kSubpixel = 16;
+// Most vertices a triangle has once clipped against the six frustum planes
+const size_t kClipped = 9;
+
+struct ClipVertex {
+  glm::vec4 position;
+  glm::vec3 color;
+};
+
+// Signed distance of a clip space position inside one of the six frustum
+// planes -w <= x, y, z <= w
+float distance(const glm::vec4 &p, int plane) {
+  auto d = p[plane / 2];
+  return plane % 2 == 0 ? p.w + d : p.w - d;
+}
+
+// Bit per frustum plane the position is outside of
+int outcode(const glm::vec4 &p) {
+  auto code = 0;
+  for (int i = 0; i < 6; i++) {
+    code |= (distance(p, i) < 0) << i;
+  }
+  return code;
+}
+
+}  // namespace
+
+const int Raster::kTile;
+
+Raster::Raster(int w, int h)
+    : width{w},
+      height{h},
+      tilesX{static_cast<size_t>((w + kTile - 1) / kTile)},
+      tilesY{static_cast<size_t>((h + kTile - 1) / kTile)} {
+  image.width = w;
+  image.height = h;
+  image.pixels.resize(static_cast<size_t>(w) * h * 4);
+}
+
+void Raster::Begin(size_t jobs) {
+  // Lists are cleared rather than freed so their storage is reused
+  triangles.resize(jobs);
+  bins.resize(jobs);
+  for (size_t j = 0; j < jobs; j++) {
+    triangles[j].clear();
+    bins[j].resize(Tiles());
+    for (auto &b : bins[j]) {
+      b.clear();
+    }
+  }
+}
+
+void Raster::Draw(size_t job, const glm::vec4 *position,
+                  const glm::vec3 *color) {
+  auto all = ~0, any = 0;
+  for (int i = 0; i < 3; i++) {
+    auto code = outcode(position[i]);
+    all &= code;
+    any |= code;
+  }
+  if (all != 0) {
+    // Every vertex is outside the same plane
+    return;
+  }
+
+  // Each plane clipped against adds at most one vertex, so the polygon
+  // fits on the stack. A pass can at worst double it, should rounding make
+  // it concave; such slivers are dropped.
+  ClipVertex polygon[kClipped], clipped[2 * kClipped];
+  size_t n = 3;
+  for (int i = 0; i < 3; i++) {
+    polygon[i] = {position[i], color[i]};
+  }
+  // Sutherland-Hodgman against only the planes the triangle crosses
+  for (int plane = 0; plane < 6; plane++) {
+    if ((any & (1 << plane)) == 0) {
+      continue;
+    }
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++) {
+      auto &a = polygon[i], &b = polygon[(i + 1) % n];
+      auto da = distance(a.position, plane), db = distance(b.position, plane);
+      if (da >= 0) {
+        clipped[m++] = a;
+      }
+      if ((da >= 0) != (db >= 0)) {
+        auto t = da / (da - db);
+        clipped[m++] = {a.position + (b.position - a.position) * t,
+                        a.color + (b.color - a.color) * t};
+      }
+    }
+    if (m < 3 || m > kClipped) {
+      return;
+    }
+    std::copy(clipped, clipped + m, polygon);
+    n = m;
+  }
+
+  // Viewport transform, rows running top to bottom like the image's
+  glm::vec4 screen[kClipped];
+  for (size_t i = 0; i < n; i++) {
+    auto &v = polygon[i];
+    if (v.position.w <= 0) {
+      return;
+    }
+    auto w = 1 / v.position.w;
+    screen[i] = {(v.position.x * w + 1) / 2 * width,
+                 (1 - v.position.y * w) / 2 * height,
+                 (v.position.z * w + 1) / 2, w};
+  }
+  // The clipped polygon is convex, so it is drawn as a fan
+  for (size_t i = 1; i + 1 < n; i++) {
+    glm::vec4 v[] = {screen[0], screen[i], screen[i + 1]};
+    glm::vec3 c[] = {polygon[0].color, polygon[i].color,
+                     polygon[i + 1].color};
+    Bin(job, v, c);
+  }
+}
+
+void Raster::Bin(size_t job, const glm::vec4 *screen, const glm::vec3 *color) {
+  glm::vec4 v[3];
+  glm::vec3 c[3];
+  for (int i = 0; i < 3; i++) {
+    v[i] = screen[i];
+    v[i].x = std::round(v[i].x * kSubpixel) / kSubpixel;
+    v[i].y = std::round(v[i].y * kSubpixel) / kSubpixel;
+    c[i] = color[i];
+  }
+  auto area = (v[2].x - v[1].x) * (v[0].y - v[1].y) -
+              (v[2].y - v[1].y) * (v[0].x - v[1].x);
+  if (area == 0) {
+    return;
+  }
+  if (area < 0) {
+    // Nothing is back-face culled, so wind every triangle the same way
+    std::swap(v[1], v[2]);
+    std::swap(c[1], c[2]);
+    area = -area;
+  }
+
+  Triangle t;
+  for (int i = 0; i < 3; i++) {
+    // Edge i runs between the other two vertices and is area at vertex i,
+    // so normalized it is vertex i's barycentric weight
+    auto &p = v[(i + 1) % 3], &q = v[(i + 2) % 3];
+    auto a = p.y - q.y, b = q.x - p.x;
+    t.topLeft[i] = a > 0 || (a == 0 && b > 0);
+    t.a[i] = a / area;
+    t.b[i] = b / area;
+    t.c[i] = (p.x * q.y - p.y * q.x) / area;
+    // Attributes are interpolated divided by w, for perspective correction
+    t.z[i] = v[i].z;
+    t.w[i] = v[i].w;
+    t.color[i] = c[i] * v[i].w;
+  }
+  // Pixels whose centers lie within the bounds
+  t.x0 = std::max(0, static_cast<int>(
+                         std::ceil(std::min({v[0].x, v[1].x, v[2].x}) - 0.5f)));
+  t.y0 = std::max(0, static_cast<int>(
+                         std::ceil(std::min({v[0].y, v[1].y, v[2].y}) - 0.5f)));
+  t.x1 = std::min(width - 1,
+                  static_cast<int>(
+                      std::floor(std::max({v[0].x, v[1].x, v[2].x}) - 0.5f)));
+  t.y1 = std::min(height - 1,
+                  static_cast<int>(
+                      std::floor(std::max({v[0].y, v[1].y, v[2].y}) - 0.5f)));
+  if (t.x0 > t.x1 || t.y0 > t.y1) {
+    return;
+  }
+
+  auto index = static_cast<uint32_t>(triangles[job].size());
+  auto binned = false;
+  for (auto ty = t.y0 / kTile; ty <= t.y1 / kTile; ty++) {
+    for (auto tx = t.x0 / kTile; tx <= t.x1 / kTile; tx++) {
+      // Skip tiles wholly outside an edge, testing the pixel center of the
+      // tile's covered rectangle furthest inside it
+      auto x0 = std::max(t.x0, tx * kTile) + 0.5f,
+           x1 = std::min(t.x1, tx * kTile + kTile - 1) + 0.5f;
+      auto y0 = std::max(t.y0, ty * kTile) + 0.5f,
+           y1 = std::min(t.y1, ty * kTile + kTile - 1) + 0.5f;
+      auto outside = false;
+      for (int i = 0; i < 3; i++) {
+        outside |= t.a[i] * (t.a[i] > 0 ? x1 : x0) +
+                       t.b[i] * (t.b[i] > 0 ? y1 : y0) + t.c[i] <
+                   0;
+      }
+      if (!outside) {
+        bins[job][ty * tilesX + tx].push_back(index);
+        binned = true;
+      }
+    }
+  }
+  if (binned) {
+    triangles[job].push_back(t);
+  }
+}
+
+void Raster::Shade(size_t tile) {
+  auto tx = static_cast<int>(tile % tilesX),
+       ty = static_cast<int>(tile / tilesX);
+  // Padded so four-wide loads at the end of a row stay in bounds
+  float depth[kTile * kTile + 4];
+  std::fill(depth, depth + kTile * kTile + 4, 1.0f);
+  for (auto y = ty * kTile; y < std::min(height, (ty + 1) * kTile); y++) {
+    auto row = &image.pixels[(static_cast<size_t>(y) * width + tx * kTile) * 4];
+    std::fill(row, row + std::min(kTile, width - tx * kTile) * 4, 0);
+  }
+  for (size_t j = 0; j < bins.size(); j++) {
+    for (auto i : bins[j][tile]) {
+      Fill(triangles[j][i], tx, ty, depth);
+    }
+  }
+}
+
+void Raster::Fill(const Triangle &t, int tx, int ty, float *depth) {
+  auto x0 = std::max(t.x0, tx * kTile),
+       x1 = std::min(t.x1, tx * kTile + kTile - 1);
+  auto y0 = std::max(t.y0, ty * kTile),
+       y1 = std::min(t.y1, ty * kTile + kTile - 1);
+  // Shade the pixel at x, y given its barycentric weights
+  auto shade = [&](int x, int y, const float *e) {
+    auto w = e[0] * t.w[0] + e[1] * t.w[1] + e[2] * t.w[2];
+    auto color =
+        (t.color[0] * e[0] + t.color[1] * e[1] + t.color[2] * e[2]) / w;
+    auto p = &image.pixels[(static_cast<size_t>(y) * width + x) * 4];
+    for (int k = 0; k < 3; k++) {
+      p[k] = static_cast<uint8_t>(
+          std::min(std::max(color[k], 0.0f), 1.0f) * 255 + 0.5f);
+    }
+    p[3] = 255;
+  };
+
+  for (auto y = y0; y <= y1; y++) {
+    // Depth of the row, indexed from the tile's left edge
+    auto d = depth + (y - ty * kTile) * kTile;
+    float row[3];
+    for (int i = 0; i < 3; i++) {
+      row[i] = t.a[i] * (x0 + 0.5f) + t.b[i] * (y + 0.5f) + t.c[i];
+    }
+#ifdef __SSE__
+    // Four pixels of the row at a time
+    auto zero = _mm_setzero_ps();
+    auto lanes = _mm_set_ps(3, 2, 1, 0);
+    __m128 a[3], r[3], tl[3];
+    for (int i = 0; i < 3; i++) {
+      a[i] = _mm_set1_ps(t.a[i]);
+      r[i] = _mm_set1_ps(row[i]);
+      tl[i] = t.topLeft[i] ? _mm_cmpeq_ps(zero, zero) : zero;
+    }
+    for (auto x = x0; x <= x1; x += 4) {
+      auto offset = _mm_add_ps(_mm_set1_ps(x - x0), lanes);
+      auto inside = _mm_cmple_ps(_mm_add_ps(_mm_set1_ps(x), lanes),
+                                 _mm_set1_ps(x1 + 0.5f));
+      __m128 e[3];
+      for (int i = 0; i < 3; i++) {
+        e[i] = _mm_add_ps(r[i], _mm_mul_ps(a[i], offset));
+        // Pixel centers on an edge belong to the triangle only if the edge
+        // is a top or left edge, so shared edges are drawn exactly once
+        inside = _mm_and_ps(
+            inside, _mm_or_ps(_mm_cmpgt_ps(e[i], zero),
+                              _mm_and_ps(_mm_cmpeq_ps(e[i], zero), tl[i])));
+      }
+      if (_mm_movemask_ps(inside) == 0) {
+        continue;
+      }
+      auto z = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(e[0], _mm_set1_ps(t.z[0])),
+                     _mm_mul_ps(e[1], _mm_set1_ps(t.z[1]))),
+          _mm_mul_ps(e[2], _mm_set1_ps(t.z[2])));
+      auto current = _mm_loadu_ps(d + x - tx * kTile);
+      auto pass = _mm_and_ps(inside, _mm_cmplt_ps(z, current));
+      auto mask = _mm_movemask_ps(pass);
+      if (mask == 0) {
+        continue;
+      }
+      _mm_storeu_ps(d + x - tx * kTile, _mm_or_ps(_mm_and_ps(pass, z),
+                                     _mm_andnot_ps(pass, current)));
+      alignas(16) float weights[3][4];
+      for (int i = 0; i < 3; i++) {
+        _mm_store_ps(weights[i], e[i]);
+      }
+      for (int k = 0; k < 4; k++) {
+        if (mask & (1 << k)) {
+          float e[] = {weights[0][k], weights[1][k], weights[2][k]};
+          shade(x + k, y, e);
+        }
+      }
+    }
+#else
+    for (auto x = x0; x <= x1; x++) {
+      float e[3];
+      auto inside = true;
+      for (int i = 0; i < 3; i++) {
+        e[i] = row[i] + t.a[i] * (x - x0);
+        inside &= e[i] > 0 || (e[i] == 0 && t.topLeft[i]);
+      }
+      if (!inside) {
+        continue;
+      }
+      auto z = e[0] * t.z[0] + e[1] * t.z[1] + e[2] * t.z[2];
+      if (z < d[x - tx * kTile]) {
+        d[x - tx * kTile] = z;
+        shade(x, y, e);
+      }
+    }
+#endif
+  }
+}
+
+}  // namespace soft
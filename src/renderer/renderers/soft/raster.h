@@ -0,0 +1,67 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_RENDERERS_SOFT_RASTER_H_
+#define SRC_RENDERER_RENDERERS_SOFT_RASTER_H_
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "src/renderer/image.h"
+
+namespace soft {
+
+// Tile-based triangle rasterizer into an in-memory image.
+// A frame is drawn in two phases: jobs clip, set up and bin triangles into
+// their own per-tile lists, then every tile is rasterized against its own
+// depth buffer. Neither phase shares writable state between jobs or between
+// tiles, so both run across the spool's workers without locks.
+class Raster {
+ public:
+  // Tile edge length in pixels
+  static const int kTile = 64;
+
+  Raster(int w, int h);
+  Raster(const Raster &) = delete;
+
+  // Start a frame binned by the given number of jobs
+  void Begin(size_t jobs);
+  // Clip, set up and bin a triangle of clip space positions and colors,
+  // safe to call concurrently for distinct jobs.
+  void Draw(size_t job, const glm::vec4 *position, const glm::vec3 *color);
+
+  size_t Tiles() const { return tilesX * tilesY; }
+  // Rasterize every triangle binned into a tile, in job then submission
+  // order, safe to call concurrently for distinct tiles.
+  void Shade(size_t tile);
+  // The frame, once every tile is shaded
+  const renderer::Image &Frame() const { return image; }
+
+ private:
+  // Screen space triangle: edge functions a * x + b * y + c, positive
+  // inside, and the attributes interpolated across it
+  struct Triangle {
+    float a[3], b[3], c[3];
+    // Whether pixel centers exactly on an edge belong to this triangle
+    bool topLeft[3];
+    float z[3], w[3];
+    glm::vec3 color[3];
+    int x0, y0, x1, y1;
+  };
+
+  // Set up and bin a triangle of screen space vertices (x, y, depth, 1 / w)
+  void Bin(size_t job, const glm::vec4 *v, const glm::vec3 *color);
+  void Fill(const Triangle &t, int tx, int ty, float *depth);
+
+  int width, height;
+  size_t tilesX, tilesY;
+  // Per job, triangles and the triangles overlapping each tile
+  std::vector<std::vector<Triangle>> triangles;
+  std::vector<std::vector<std::vector<uint32_t>>> bins;
+  renderer::Image image;
+};
+
+}  // namespace soft
+
+#endif  // SRC_RENDERER_RENDERERS_SOFT_RASTER_H_
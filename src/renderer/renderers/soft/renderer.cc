@@ -0,0 +1,190 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/renderers/soft/renderer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "src/events.h"
+#include "src/renderer/animation.h"
+#include "src/renderer/chain.h"
+#include "src/renderer/cull.h"
+#include "src/renderer/event/event.h"
+#include "src/spool.h"
+
+namespace soft {
+
+namespace {
+
+// Instances transformed and binned by a single job
+const size_t kInstancesPerJob = 512;
+
+}  // namespace
+
+Mesh::Mesh(size_t i, std::shared_ptr<renderer::Rasterizable> g)
+    : id{i}, geometry{g} {
+  for (size_t j = 0; j < g->VertexCount(); j++) {
+    radius = std::max(radius, glm::length(g->Vertices()[j].position));
+  }
+}
+
+Renderer::Renderer(
+    std::vector<std::shared_ptr<renderer::Renderable>> v,
+    std::function<std::shared_ptr<renderer::Renderable>(size_t w, size_t h)> p,
+    int w, int h, renderer::Output o, uint64_t f, renderer::Clock c)
+    : views{v},
+      projection{p},
+      width{w},
+      height{h},
+      output{o},
+      frames{f},
+      clock{c},
+      raster{w, h},
+      renderThread{[&] {
+        for (uint64_t i = 0; frames == 0 || i < frames; i++) {
+          // Draw the latest snapshot, waiting for the first spawn
+          auto snapshot = scene.Wait();
+          Draw(*snapshot, clock.Tick());
+        }
+        // Release the output, flushing the frames it is still writing, and
+        // end the run
+        output = nullptr;
+        Spool::Instance()->Handle(std::shared_ptr<Event>{
+            new events::Terminate{"soft::Renderer: every frame drawn"}});
+      }} {}
+
+void Renderer::Draw(const Scene::Snapshot &snapshot,
+                    const renderer::Frame &frame) {
+  // Each job is a run of one group's instances, so shares one mesh
+  std::vector<std::pair<size_t, size_t>> jobs;
+  for (size_t g = 0; g < snapshot.Groups(); g++) {
+    for (size_t i = 0; i < snapshot[g].Size(); i += kInstancesPerJob) {
+      jobs.push_back({g, i});
+    }
+  }
+
+  // Transforms are computed once per frame for every view
+  std::vector<std::vector<glm::mat4>> models(jobs.size());
+  Spool::Instance()->Parallel(jobs.size(), [&](size_t j) {
+    auto &group = snapshot[jobs[j].first];
+    auto end = std::min(group.Size(), jobs[j].second + kInstancesPerJob);
+    thread_local renderer::Models batch;
+    batch.Clear();
+    for (auto i = jobs[j].second; i < end; i++) {
+      batch.Add(*group[i].model);
+    }
+    batch.Evaluate(frame, &models[j]);
+  });
+
+  for (size_t v = 0; v < views.size(); v++) {
+    glm::mat4 vp(1.0);
+    for (auto i : projection(width, height)->Render(frame)) {
+      vp *= i;
+    }
+    for (auto i : std::atomic_load(&views[v])->Render(frame)) {
+      vp *= i;
+    }
+    renderer::Frustum frustum{vp};
+
+    // Transform, cull and bin every job's triangles, then shade every tile
+    raster.Begin(jobs.size());
+    Spool::Instance()->Parallel(jobs.size(), [&](size_t j) {
+      auto &mesh = *snapshot[jobs[j].first][0].mesh;
+      auto &geometry = mesh.Geometry();
+      auto vertices = geometry.Vertices();
+      auto indices = geometry.Indices();
+      // Kept per worker so transforming vertices does not allocate once warm
+      thread_local std::vector<glm::vec4> clip;
+      clip.resize(geometry.VertexCount());
+      for (auto &m : models[j]) {
+        // The mesh's bounding sphere scaled by the largest axis scale
+        auto r = mesh.Radius() * std::max({glm::length(glm::vec3(m[0])),
+                                           glm::length(glm::vec3(m[1])),
+                                           glm::length(glm::vec3(m[2]))});
+        if (frustum.Classify(glm::vec3(m[3]), glm::vec3(r, r, r)) ==
+            renderer::Visibility::kOutside) {
+          continue;
+        }
+        auto mvp = vp * m;
+        for (size_t i = 0; i < clip.size(); i++) {
+          clip[i] = mvp * glm::vec4(vertices[i].position, 1);
+        }
+        for (size_t i = 0; i + 2 < geometry.IndexCount(); i += 3) {
+          glm::vec4 position[] = {clip[indices[i]], clip[indices[i + 1]],
+                                  clip[indices[i + 2]]};
+          glm::vec3 color[] = {vertices[indices[i]].color,
+                               vertices[indices[i + 1]].color,
+                               vertices[indices[i + 2]].color};
+          raster.Draw(j, position, color);
+        }
+      }
+    });
+    Spool::Instance()->Parallel(raster.Tiles(),
+                                [&](size_t t) { raster.Shade(t); });
+    output(v, frame.number, raster.Frame());
+  }
+}
+
+std::unique_ptr<renderer::shapes::Factory> Renderer::ShapeFactory() {
+  return std::unique_ptr<renderer::shapes::Factory>(new shapes::Factory());
+}
+
+std::shared_ptr<Mesh> Renderer::Intern(
+    std::shared_ptr<renderer::Rasterizable> geometry) {
+  auto &m = meshes[geometry.get()];
+  if (m == nullptr) {
+    m.reset(new Mesh{meshes.size() - 1, geometry});
+  }
+  return m;
+}
+
+void Renderer::Handle(std::shared_ptr<Event> const e) {
+  ([&](std::shared_ptr<event::Spawn> spawn) {
+    if (spawn != nullptr) {
+      // Objects are grouped by the geometry they were spawned with
+      std::shared_ptr<Mesh> mesh;
+      {
+        std::unique_lock<std::mutex> lock(meshesMutex);
+        mesh = Intern(spawn->Display());
+      }
+      scene.Append(mesh->Id(), Object{mesh, renderer::Chain(spawn->Model())},
+                   spawn->Id());
+    }
+  })(std::dynamic_pointer_cast<event::Spawn>(e));
+  ([&](std::shared_ptr<event::SpawnBatch> batch) {
+    if (batch != nullptr) {
+      std::vector<std::pair<size_t, Object>> objects;
+      std::vector<renderer::Handle> handles;
+      objects.reserve(batch->Records().size());
+      handles.reserve(batch->Records().size());
+      {
+        std::unique_lock<std::mutex> lock(meshesMutex);
+        std::shared_ptr<Mesh> mesh;
+        for (auto &r : batch->Records()) {
+          if (mesh == nullptr || &mesh->Geometry() != r.display.get()) {
+            mesh = Intern(r.display);
+          }
+          objects.push_back({mesh->Id(), Object{mesh, r.model}});
+          handles.push_back(r.handle);
+        }
+      }
+      scene.Append(std::move(objects), handles);
+    }
+  })(std::dynamic_pointer_cast<event::SpawnBatch>(e));
+  ([&](std::shared_ptr<event::Despawn> despawn) {
+    if (despawn != nullptr) {
+      scene.Remove(despawn->Handles());
+    }
+  })(std::dynamic_pointer_cast<event::Despawn>(e));
+  ([&](std::shared_ptr<event::View> view) {
+    if (view != nullptr && view->Index() < views.size()) {
+      // Read by the render thread each frame
+      std::atomic_store(&views[view->Index()], view->Camera());
+    }
+  })(std::dynamic_pointer_cast<event::View>(e));
+}
+
+}  // namespace soft
@@ -0,0 +1,89 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_RENDERERS_SOFT_RENDERER_H_
+#define SRC_RENDERER_RENDERERS_SOFT_RENDERER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "src/renderer/clock.h"
+#include "src/renderer/image.h"
+#include "src/renderer/renderer.h"
+#include "src/renderer/renderers/soft/raster.h"
+#include "src/renderer/renderers/soft/shapes.h"
+#include "src/renderer/scene.h"
+
+namespace soft {
+
+// Spawned geometry and the scene group its instances are drawn from
+class Mesh {
+ public:
+  Mesh(size_t i, std::shared_ptr<renderer::Rasterizable> g);
+
+  size_t Id() const { return id; }
+  // Radius of the bounding sphere about the origin in model space
+  float Radius() const { return radius; }
+  const renderer::Rasterizable &Geometry() const { return *geometry; }
+
+ private:
+  size_t id;
+  std::shared_ptr<renderer::Rasterizable> geometry;
+  float radius = 0;
+};
+
+// A spawned mesh and the model transforms placing it
+struct Object {
+  std::shared_ptr<Mesh> mesh;
+  std::shared_ptr<renderer::Renderable> model;
+};
+
+using Scene = renderer::Scene<Object>;
+
+// Rasterizes one scene on the CPU into an image per view, handing every
+// frame to an output; needs no GPU or display.
+class Renderer : public renderer::Renderer {
+ public:
+  // Renders w by h frames, stopping after frames frames unless frames is 0
+  Renderer(
+      std::vector<std::shared_ptr<renderer::Renderable>> v,
+      std::function<std::shared_ptr<renderer::Renderable>(size_t, size_t)> p,
+      int w, int h, renderer::Output o, uint64_t frames = 0,
+      renderer::Clock c = renderer::Clock::Real());
+  ~Renderer() {}
+  std::unique_ptr<renderer::shapes::Factory> ShapeFactory() override;
+  void Render() override {}
+  void Handle(std::shared_ptr<Event> const e) override;
+
+ private:
+  // Draw the snapshot into every view at frame's time
+  void Draw(const Scene::Snapshot &snapshot, const renderer::Frame &frame);
+  // Mesh of spawned geometry, with meshesMutex held
+  std::shared_ptr<Mesh> Intern(std::shared_ptr<renderer::Rasterizable> g);
+
+  // Each view's camera, replaced atomically by View events
+  std::vector<std::shared_ptr<renderer::Renderable>> views;
+  std::function<std::shared_ptr<renderer::Renderable>(size_t w, size_t h)>
+      projection;
+  int width, height;
+  renderer::Output output;
+  uint64_t frames;
+  // Render thread only
+  renderer::Clock clock;
+  Scene scene;
+  // Meshes by the geometry they were spawned with
+  std::mutex meshesMutex;
+  std::unordered_map<const renderer::Rasterizable *, std::shared_ptr<Mesh>>
+      meshes;
+  // Render thread only
+  Raster raster;
+  std::thread renderThread;
+};
+
+}  // namespace soft
+
+#endif  // SRC_RENDERER_RENDERERS_SOFT_RENDERER_H_
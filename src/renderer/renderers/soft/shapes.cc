@@ -0,0 +1,17 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/renderers/soft/shapes.h"
+
+#include <memory>
+
+namespace soft {
+namespace shapes {
+
+std::shared_ptr<renderer::Rasterizable> Factory::Cube() {
+  // Built once; every cube shares the same geometry
+  static auto cube = renderer::shapes::CubeGeometry();
+  return cube;
+}
+
+}  // namespace shapes
+}  // namespace soft
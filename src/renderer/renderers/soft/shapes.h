@@ -0,0 +1,21 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_RENDERERS_SOFT_SHAPES_H_
+#define SRC_RENDERER_RENDERERS_SOFT_SHAPES_H_
+
+#include <memory>
+
+#include "src/renderer/renderer.h"
+
+namespace soft {
+namespace shapes {
+
+class Factory : public renderer::shapes::Factory {
+ public:
+  std::shared_ptr<renderer::Rasterizable> Cube() override;
+};
+
+}  // namespace shapes
+}  // namespace soft
+
+#endif  // SRC_RENDERER_RENDERERS_SOFT_SHAPES_H_
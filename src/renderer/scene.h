@@ -0,0 +1,318 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_SCENE_H_
+#define SRC_RENDERER_SCENE_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "src/renderer/handle.h"
+
+namespace renderer {
+
+// Collection of spawned objects shared between the actors spawning into it
+// and a render thread drawing it.
+// Objects are appended to numbered groups (e.g. one per mesh) so readers get
+// them pre-batched. Writers change a pending generation under a writer-only
+// lock and publish it as an immutable Snapshot; readers atomically load the
+// latest Snapshot and never take a lock, so spawning and rendering do not
+// stall one another.
+// Objects named by a handle can be removed: the group's last object is
+// moved into the hole, keeping groups dense, and chunks a published snapshot
+// may read are copied rather than written.
+// A scene which is not shared is only touched by one thread, so nothing is
+// copied: its snapshot is a view of the objects as they are, valid until
+// they next change.
+template <typename T>
+class Scene {
+ public:
+  // Objects per chunk; chunks are shared between snapshots and never move
+  static const size_t kChunk = 1024;
+
+  class Group {
+   public:
+    size_t Size() const { return size; }
+    const T &operator[](size_t i) const {
+      return (*(*table)[i / kChunk])[i % kChunk];
+    }
+
+   private:
+    friend class Scene;
+    // Slots no snapshot reads are written in place, so a table and its
+    // chunks are filled while published snapshots share them.
+    std::shared_ptr<std::vector<std::shared_ptr<std::array<T, kChunk>>>>
+        table;
+    size_t size = 0;
+  };
+
+  class Snapshot {
+   public:
+    size_t Size() const { return size; }
+    uint64_t Generation() const { return generation; }
+    size_t Groups() const { return groups.size(); }
+    const Group &operator[](size_t g) const { return groups[g]; }
+
+   private:
+    friend class Scene;
+    std::vector<Group> groups;
+    size_t size = 0;
+    uint64_t generation = 0;
+  };
+
+  // Scene whose snapshots are read by other threads, unless s is false
+  explicit Scene(bool s = true)
+      : shared{s},
+        latest{s ? std::make_shared<const Snapshot>()
+                 : std::shared_ptr<const Snapshot>{
+                       std::shared_ptr<const Snapshot>{}, &pending}} {}
+  Scene(const Scene &) = delete;
+
+  // Append an object, named by h if it is not null
+  void Append(size_t g, T t, Handle h = Handle{}) {
+    std::unique_lock<std::mutex> lock(writeLock);
+    Resize(g + 1);
+    Reserve(g, pending.groups[g].size + 1);
+    Place(g, std::move(t), h);
+    Publish();
+  }
+
+  // Append objects to their groups, publishing them all at once. The i-th
+  // object is named by handles[i], if there are handles.
+  void Append(std::vector<std::pair<size_t, T>> v,
+              const std::vector<Handle> &handles = {}) {
+    std::unique_lock<std::mutex> lock(writeLock);
+    // Every group's chunk table is sized once for all its objects
+    std::vector<size_t> counts(pending.groups.size());
+    for (auto &o : v) {
+      if (counts.size() <= o.first) {
+        counts.resize(o.first + 1);
+      }
+      counts[o.first]++;
+    }
+    Resize(counts.size());
+    for (size_t g = 0; g < counts.size(); g++) {
+      if (counts[g] != 0) {
+        Reserve(g, pending.groups[g].size + counts[g]);
+      }
+    }
+    for (size_t i = 0; i < v.size(); i++) {
+      Place(v[i].first, std::move(v[i].second),
+            i < handles.size() ? handles[i] : Handle{});
+    }
+    Publish();
+  }
+
+  // Remove the objects named by handles, publishing once. A handle may be
+  // removed before the object it names is appended, which then never is.
+  void Remove(const std::vector<Handle> &handles) {
+    std::unique_lock<std::mutex> lock(writeLock);
+    for (auto h : handles) {
+      if (!h) {
+        continue;
+      }
+      auto &l = Locate(h);
+      l.removed = std::max(l.removed, h.generation);
+      if (l.generation != 0 && l.generation <= h.generation) {
+        Erase(h.index);
+      }
+    }
+    Publish();
+  }
+
+  // Publish a generation with no new objects, so waiting renderers draw
+  // again after a change outside the scene
+  void Touch() {
+    std::unique_lock<std::mutex> lock(writeLock);
+    Publish();
+  }
+
+  // Latest published snapshot
+  std::shared_ptr<const Snapshot> Latest() const {
+    return std::atomic_load(&latest);
+  }
+
+  // Block until a snapshot newer than generation g is published
+  std::shared_ptr<const Snapshot> Wait(uint64_t g = 0) {
+    auto s = Latest();
+    if (s->Generation() > g) {
+      return s;
+    }
+    std::unique_lock<std::mutex> lock(writeLock);
+    published.wait(lock, [&] { return pending.generation > g; });
+    return Latest();
+  }
+
+ private:
+  // Index of the handle naming each object of a group, or kUnnamed
+  static constexpr uint32_t kUnnamed = ~0u;
+
+  // Writer state of a group, kept out of snapshots so publishing does not
+  // copy it
+  struct Owner {
+    std::vector<uint32_t> handles;
+    // Largest size published, so slots past it are read by no snapshot
+    size_t visible = 0;
+    // Generation the table and each chunk were copied for; those of the
+    // pending generation are not yet shared
+    uint64_t table = 0;
+    std::vector<uint64_t> chunks;
+  };
+
+  // Where the object of a handle index is
+  struct Location {
+    // Generation of the object there, or 0 if none, and the latest
+    // generation removed
+    uint32_t generation = 0, removed = 0;
+    size_t group = 0, index = 0;
+  };
+
+  const bool shared;
+  std::mutex writeLock;
+  std::condition_variable published;
+  Snapshot pending;
+  std::shared_ptr<const Snapshot> latest;
+  std::vector<Owner> owners;
+  // By handle index; as large as the most handles alive at once
+  std::vector<Location> locations;
+
+  // Have at least n groups
+  void Resize(size_t n) {
+    if (pending.groups.size() < n) {
+      pending.groups.resize(n);
+      owners.resize(n);
+    }
+  }
+
+  Location &Locate(Handle h) {
+    if (locations.size() <= h.index) {
+      locations.resize(h.index + 1);
+    }
+    return locations[h.index];
+  }
+
+  // Size a group's chunk table to hold n objects, at least doubling it when
+  // it grows
+  void Reserve(size_t g, size_t n) {
+    auto &group = pending.groups[g];
+    auto chunks = (n + kChunk - 1) / kChunk;
+    auto c = group.table == nullptr ? 0 : group.table->size();
+    if (chunks > c) {
+      auto table = std::make_shared<
+          std::vector<std::shared_ptr<std::array<T, kChunk>>>>(
+          std::max(chunks, 2 * c));
+      for (size_t i = 0; i < c; i++) {
+        (*table)[i] = (*group.table)[i];
+      }
+      group.table = table;
+      owners[g].table = pending.generation + 1;
+    }
+  }
+
+  // Slot i of a group with room in its chunk table, for writing. A slot a
+  // published snapshot may read is written in a copy of its chunk, and of
+  // the table holding it, private to the pending generation.
+  T &Slot(size_t g, size_t i) {
+    auto &group = pending.groups[g];
+    auto &owner = owners[g];
+    auto c = i / kChunk;
+    if (i >= owner.visible) {
+      auto &chunk = (*group.table)[c];
+      if (chunk == nullptr) {
+        chunk = std::make_shared<std::array<T, kChunk>>();
+      }
+      return (*chunk)[i % kChunk];
+    }
+    auto next = pending.generation + 1;
+    if (owner.table != next) {
+      group.table = std::make_shared<
+          std::vector<std::shared_ptr<std::array<T, kChunk>>>>(*group.table);
+      owner.table = next;
+    }
+    if (owner.chunks.size() <= c) {
+      owner.chunks.resize(c + 1);
+    }
+    auto &chunk = (*group.table)[c];
+    if (owner.chunks[c] != next) {
+      chunk = std::make_shared<std::array<T, kChunk>>(*chunk);
+      owner.chunks[c] = next;
+    }
+    return (*chunk)[i % kChunk];
+  }
+
+  // Append to a group with room in its chunk table, unless h names an
+  // object already removed or superseded
+  void Place(size_t g, T t, Handle h) {
+    if (h) {
+      auto &l = Locate(h);
+      if (h.generation <= l.removed || h.generation <= l.generation) {
+        return;
+      }
+      // An older object of the index, whose removal has not been seen
+      if (l.generation != 0) {
+        Erase(h.index);
+      }
+      l.generation = h.generation;
+      l.group = g;
+      l.index = pending.groups[g].size;
+    }
+    auto &group = pending.groups[g];
+    Slot(g, group.size) = std::move(t);
+    owners[g].handles.push_back(h ? h.index : kUnnamed);
+    group.size++;
+    pending.size++;
+  }
+
+  // Remove the object of a handle index, moving its group's last object
+  // into its slot
+  void Erase(uint32_t h) {
+    auto &l = locations[h];
+    auto &group = pending.groups[l.group];
+    auto &owner = owners[l.group];
+    auto last = group.size - 1;
+    auto &hole = Slot(l.group, l.index);
+    auto &end = Slot(l.group, last);
+    if (l.index != last) {
+      hole = std::move(end);
+      auto moved = owner.handles[last];
+      owner.handles[l.index] = moved;
+      if (moved != kUnnamed) {
+        locations[moved].index = l.index;
+      }
+    }
+    // Release what the removed object held
+    end = T{};
+    owner.handles.pop_back();
+    group.size--;
+    pending.size--;
+    l.generation = 0;
+  }
+
+  // Publish the pending generation
+  void Publish() {
+    pending.generation++;
+    if (!shared) {
+      // Latest is a view of pending, and no slot is ever visible to another
+      // thread, so none is copied
+      published.notify_all();
+      return;
+    }
+    for (size_t g = 0; g < owners.size(); g++) {
+      owners[g].visible =
+          std::max(owners[g].visible, pending.groups[g].size);
+    }
+    std::atomic_store(&latest,
+                      std::shared_ptr<const Snapshot>{new Snapshot(pending)});
+    published.notify_all();
+  }
+};
+
+}  // namespace renderer
+
+#endif  // SRC_RENDERER_SCENE_H_
@@ -0,0 +1,253 @@
+// Copyright 2016 Connor Taffe
+
+// Churns a scene's objects by handle while a reader draws its snapshots,
+// checking every snapshot is whole and the survivors are exactly those
+// still spawned, measures how much churning delays the reader's frames, and
+// checks another origin's handles never collide with this process' own.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "src/renderer/handle.h"
+#include "src/renderer/scene.h"
+
+namespace {
+
+struct Object {
+  std::shared_ptr<int> id;
+};
+
+void check(bool ok, const char *what) {
+  if (!ok) {
+    std::cerr << "scene_test: FAIL: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+// Ids of every object of the latest snapshot, by how often each appears
+std::map<int, int> ids(const renderer::Scene<Object> &scene) {
+  auto s = scene.Latest();
+  std::map<int, int> seen;
+  for (size_t g = 0; g < s->Groups(); g++) {
+    for (size_t i = 0; i < (*s)[g].Size(); i++) {
+      seen[*(*s)[g][i].id]++;
+    }
+  }
+  return seen;
+}
+
+// 100k objects in four groups, of which 1000 are despawned and 1000 more
+// spawned a hundred times over, read by another thread if the scene is
+// shared
+void churn(bool shared) {
+  auto handles = renderer::Handles::Instance();
+  renderer::Scene<Object> scene{shared};
+  std::atomic<bool> done{false};
+  std::atomic<size_t> reads{0};
+  std::thread reader{[&] {
+    while (shared && !done) {
+      auto s = scene.Latest();
+      size_t n = 0;
+      for (size_t g = 0; g < s->Groups(); g++) {
+        for (size_t i = 0; i < (*s)[g].Size(); i++) {
+          check((*s)[g][i].id != nullptr, "a snapshot held a removed object");
+          n++;
+        }
+      }
+      check(n == s->Size(), "a snapshot's size was not its objects'");
+      reads++;
+    }
+  }};
+
+  std::mt19937_64 random{1};
+  std::vector<std::pair<renderer::Handle, int>> live;
+  int next = 0;
+  auto spawn = [&](size_t n) {
+    std::vector<std::pair<size_t, Object>> objects;
+    std::vector<renderer::Handle> named;
+    for (size_t i = 0; i < n; i++) {
+      auto h = handles->Acquire();
+      objects.push_back({random() % 4, Object{std::make_shared<int>(next)}});
+      named.push_back(h);
+      live.push_back({h, next++});
+    }
+    scene.Append(std::move(objects), named);
+  };
+  spawn(100000);
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < 100; round++) {
+    std::vector<renderer::Handle> gone;
+    for (int i = 0; i < 1000; i++) {
+      auto k = random() % live.size();
+      gone.push_back(live[k].first);
+      handles->Release(live[k].first);
+      live[k] = live.back();
+      live.pop_back();
+    }
+    scene.Remove(gone);
+    // Removing again is ignored
+    scene.Remove({gone[0]});
+    spawn(1000);
+  }
+  auto seconds = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  // A removal overtaking its spawn drops the spawn
+  auto h = handles->Acquire();
+  scene.Remove({h});
+  scene.Append(0, Object{std::make_shared<int>(-1)}, h);
+  done = true;
+  reader.join();
+
+  auto seen = ids(scene);
+  check(seen.size() == live.size() && scene.Latest()->Size() == live.size(),
+        "the scene did not hold exactly the live objects");
+  for (auto &l : live) {
+    check(seen.count(l.second) == 1, "a live object was lost");
+  }
+  std::cout << "churn: " << (shared ? "shared" : "unshared") << " scene, "
+            << 200000 / seconds << " objects spawned or despawned per second, "
+            << reads << " snapshots read" << std::endl;
+}
+
+// Time of each frame a reader draws of 100k objects in 300ms, while another
+// thread spawns and despawns 1000 of them every millisecond if churning
+std::vector<double> frames(bool churning) {
+  using Clock = std::chrono::steady_clock;
+  auto handles = renderer::Handles::Instance();
+  renderer::Scene<Object> scene;
+  std::vector<std::pair<size_t, Object>> objects;
+  std::vector<renderer::Handle> live;
+  for (int i = 0; i < 100000; i++) {
+    objects.push_back({0, Object{std::shared_ptr<int>(new int(i))}});
+    live.push_back(handles->Acquire());
+  }
+  scene.Append(std::move(objects), live);
+
+  std::atomic<bool> done{false};
+  std::thread writer{[&] {
+    std::mt19937_64 random{2};
+    while (churning && !done) {
+      std::vector<renderer::Handle> gone;
+      std::vector<std::pair<size_t, Object>> spawned;
+      std::vector<renderer::Handle> named;
+      for (int i = 0; i < 1000; i++) {
+        auto &h = live[random() % live.size()];
+        gone.push_back(h);
+        handles->Release(h);
+        h = handles->Acquire();
+        spawned.push_back({0, Object{std::shared_ptr<int>(new int(i))}});
+        named.push_back(h);
+      }
+      scene.Remove(gone);
+      scene.Append(std::move(spawned), named);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }};
+  std::vector<double> times;
+  int64_t sum = 0;
+  for (auto end = Clock::now() + std::chrono::milliseconds(300);
+       Clock::now() < end;) {
+    auto start = Clock::now();
+    auto s = scene.Latest();
+    for (size_t i = 0; i < (*s)[0].Size(); i++) {
+      sum += *(*s)[0][i].id;
+    }
+    times.push_back(
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count());
+  }
+  done = true;
+  writer.join();
+  check(sum != 0, "nothing was read");
+  std::sort(times.begin(), times.end());
+  return times;
+}
+
+// Frames are no slower to draw while objects are spawned at a high rate
+void jitter() {
+  auto idle = frames(false), churning = frames(true);
+  auto p99 = [](const std::vector<double> &t) {
+    return t[t.size() * 99 / 100];
+  };
+  std::cout << "jitter: frames took " << idle[idle.size() / 2] << "ms p50, "
+            << p99(idle) << "ms p99 idle, and "
+            << churning[churning.size() / 2] << "ms p50, " << p99(churning)
+            << "ms p99 while churning" << std::endl;
+  // With one core the writer preempts the reader, however little it locks
+  if (std::thread::hardware_concurrency() > 1) {
+    check(p99(churning) < 2 * p99(idle) + 1, "churning stalled frames");
+  }
+}
+
+// Handles decoded from another origin, e.g. a replayed journal, reuse the
+// indices of this process' own
+void origins() {
+  auto handles = renderer::Handles::Instance();
+  renderer::Scene<Object> scene;
+  auto origin = 7;
+  std::vector<renderer::Handle> local, remote;
+  std::vector<std::pair<size_t, Object>> objects;
+  for (int i = 0; i < 100; i++) {
+    local.push_back(handles->Acquire());
+    objects.push_back({0, Object{std::make_shared<int>(i)}});
+  }
+  scene.Append(std::move(objects), local);
+  // The other origin names its objects with the same handles
+  objects.clear();
+  for (int i = 0; i < 100; i++) {
+    remote.push_back(handles->Translate(origin, local[i]));
+    objects.push_back({0, Object{std::make_shared<int>(100 + i)}});
+  }
+  check(handles->Translate(origin, local[0]).index == remote[0].index,
+        "a handle was translated twice");
+  scene.Append(std::move(objects), remote);
+  check(scene.Latest()->Size() == 200, "another origin's objects collided");
+
+  // Despawning the other origin's objects leaves this process' alone
+  std::vector<renderer::Handle> gone;
+  for (auto &l : local) {
+    gone.push_back(handles->Forget(origin, l));
+    handles->Release(gone.back());
+  }
+  check(!handles->Forget(origin, local[0]), "a handle was forgotten twice");
+  scene.Remove(gone);
+  auto seen = ids(scene);
+  check(seen.size() == 100 && seen.begin()->first == 0 &&
+            seen.rbegin()->first == 99,
+        "the wrong origin's objects were removed");
+
+  // A newer generation of an index releases the local handle of the older,
+  // whose despawn was never seen, and an ended origin is no longer
+  // translated
+  auto older = handles->Translate(origin, renderer::Handle{1000, 1});
+  auto newer = handles->Translate(origin, renderer::Handle{1000, 2});
+  check(newer.index == older.index && newer.generation != older.generation,
+        "a replaced translation's local handle was not released");
+  handles->Drop(origin);
+  check(!handles->Forget(origin, renderer::Handle{1000, 2}),
+        "an ended origin's handles were still translated");
+  handles->Release(newer);
+  std::cout << "origins: another origin's handles were kept apart"
+            << std::endl;
+}
+
+}  // namespace
+
+int main() {
+  churn(true);
+  churn(false);
+  jitter();
+  origins();
+  std::cout << "scene_test: PASS" << std::endl;
+}
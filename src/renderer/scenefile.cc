@@ -0,0 +1,216 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/scenefile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace renderer {
+
+namespace {
+
+const char kMagic[8] = {'A', 'C', 'T', 'S', 'C', 'E', 'N', 'E'};
+
+// Records are read in place, so their layout is part of the format
+static_assert(sizeof(Vertex) == 36, "Vertex layout changed");
+static_assert(sizeof(Track) == 28, "Track layout changed");
+static_assert(sizeof(glm::mat4) == 64, "glm::mat4 layout changed");
+
+uint64_t align(uint64_t offset) {
+  return (offset + SceneFile::kAlign - 1) / SceneFile::kAlign *
+         SceneFile::kAlign;
+}
+
+}  // namespace
+
+const uint32_t SceneFile::kVersion;
+const size_t SceneFile::kAlign;
+
+std::shared_ptr<SceneFile> SceneFile::Open(const std::string &path) {
+  auto fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("renderer::SceneFile: cannot open " + path);
+  }
+  struct stat st;
+  auto d = fstat(fd, &st) == 0 && st.st_size > 0
+               ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)
+               : MAP_FAILED;
+  close(fd);
+  if (d == MAP_FAILED) {
+    throw std::runtime_error("renderer::SceneFile: cannot map " + path);
+  }
+  return std::shared_ptr<SceneFile>{
+      new SceneFile{d, static_cast<size_t>(st.st_size)}};
+}
+
+template <typename T>
+const T *SceneFile::At(uint64_t offset, uint64_t n) const {
+  if (offset % alignof(T) != 0 || offset > size ||
+      n > (size - offset) / sizeof(T)) {
+    throw std::runtime_error("renderer::SceneFile: section out of bounds");
+  }
+  return reinterpret_cast<const T *>(data + offset);
+}
+
+SceneFile::SceneFile(const void *d, size_t s)
+    : data{static_cast<const char *>(d)}, size{s} {
+  try {
+    auto header = At<Header>(0, 1);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+      throw std::runtime_error("renderer::SceneFile: not a scene file");
+    }
+    if (header->version != kVersion) {
+      throw std::runtime_error("renderer::SceneFile: unsupported version " +
+                               std::to_string(header->version));
+    }
+    auto records = At<MeshRecord>(header->meshOffset, header->meshes);
+    for (uint32_t i = 0; i < header->meshes; i++) {
+      auto &r = records[i];
+      auto v = At<Vertex>(r.vertexOffset, r.vertexCount);
+      auto ind = At<uint32_t>(r.indexOffset, r.indexCount);
+      for (uint64_t j = 0; j < r.indexCount; j++) {
+        if (ind[j] >= r.vertexCount) {
+          throw std::runtime_error("renderer::SceneFile: index out of range");
+        }
+      }
+      meshes.emplace_back(v, r.vertexCount, ind, r.indexCount);
+    }
+    instances =
+        At<InstanceRecord>(header->instanceOffset, header->instances);
+    auto tracks = At<Track>(header->trackOffset, header->tracks);
+    auto matrices = At<glm::mat4>(header->matrixOffset, header->matrices);
+    models.reserve(header->instances);
+    for (uint64_t i = 0; i < header->instances; i++) {
+      auto &r = instances[i];
+      if (r.mesh >= header->meshes || r.track > header->tracks ||
+          r.tracks > header->tracks - r.track ||
+          r.matrix >= header->matrices ||
+          r.tracks >= header->matrices - r.matrix) {
+        throw std::runtime_error("renderer::SceneFile: bad instance");
+      }
+      models.emplace_back(matrices + r.matrix, tracks + r.track, r.tracks);
+    }
+  } catch (...) {
+    munmap(const_cast<char *>(data), size);
+    throw;
+  }
+}
+
+SceneFile::~SceneFile() { munmap(const_cast<char *>(data), size); }
+
+size_t SceneFile::Instances() const { return models.size(); }
+
+std::vector<event::SpawnBatch::Record> SceneFile::Records() {
+  // Views share ownership of the file rather than being owned separately
+  auto self = shared_from_this();
+  std::vector<std::shared_ptr<Rasterizable>> displays;
+  for (auto &m : meshes) {
+    displays.emplace_back(self, &m);
+  }
+  std::vector<event::SpawnBatch::Record> records;
+  records.reserve(models.size());
+  for (size_t i = 0; i < models.size(); i++) {
+    records.push_back({displays[instances[i].mesh],
+                       std::shared_ptr<Renderable>(self, &models[i])});
+  }
+  return records;
+}
+
+void SceneFile::Write(const std::string &path,
+                      const std::vector<event::SpawnBatch::Record> &records) {
+  std::vector<const Rasterizable *> displays;
+  std::unordered_map<const Rasterizable *, uint32_t> ids;
+  std::vector<InstanceRecord> instances;
+  std::vector<Track> tracks;
+  std::vector<glm::mat4> matrices;
+  for (auto &r : records) {
+    auto id = ids.insert({r.display.get(), displays.size()});
+    if (id.second) {
+      displays.push_back(r.display.get());
+    }
+    Flat flat;
+    if (!Flatten(*r.model, &flat)) {
+      throw std::runtime_error(
+          "renderer::SceneFile: model has a renderable which is neither "
+          "constant nor a track");
+    }
+    instances.push_back({id.first->second,
+                         static_cast<uint32_t>(flat.tracks.size()),
+                         tracks.size(), matrices.size()});
+    tracks.insert(tracks.end(), flat.tracks.begin(), flat.tracks.end());
+    matrices.insert(matrices.end(), flat.folded.begin(), flat.folded.end());
+  }
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.meshes = displays.size();
+  header.instances = instances.size();
+  header.tracks = tracks.size();
+  header.matrices = matrices.size();
+  header.meshOffset = align(sizeof(Header));
+  header.instanceOffset =
+      align(header.meshOffset + displays.size() * sizeof(MeshRecord));
+  header.trackOffset = align(header.instanceOffset +
+                             instances.size() * sizeof(InstanceRecord));
+  header.matrixOffset =
+      align(header.trackOffset + tracks.size() * sizeof(Track));
+  auto offset =
+      align(header.matrixOffset + matrices.size() * sizeof(glm::mat4));
+  std::vector<MeshRecord> meshes;
+  for (auto d : displays) {
+    MeshRecord m;
+    m.vertexOffset = offset;
+    m.vertexCount = d->VertexCount();
+    m.indexOffset = align(m.vertexOffset + m.vertexCount * sizeof(Vertex));
+    m.indexCount = d->IndexCount();
+    offset = align(m.indexOffset + m.indexCount * sizeof(uint32_t));
+    meshes.push_back(m);
+  }
+
+  std::ofstream out(path, std::ios::binary);
+  if (!out) {
+    throw std::runtime_error("renderer::SceneFile: cannot open " + path);
+  }
+  auto write = [&](uint64_t at, const void *p, size_t n) {
+    static const char zeros[kAlign] = {};
+    for (auto pos = static_cast<uint64_t>(out.tellp()); pos < at;
+         pos += kAlign) {
+      out.write(zeros, std::min<uint64_t>(kAlign, at - pos));
+    }
+    out.write(static_cast<const char *>(p), n);
+  };
+  write(0, &header, sizeof(header));
+  write(header.meshOffset, meshes.data(), meshes.size() * sizeof(MeshRecord));
+  write(header.instanceOffset, instances.data(),
+        instances.size() * sizeof(InstanceRecord));
+  write(header.trackOffset, tracks.data(), tracks.size() * sizeof(Track));
+  write(header.matrixOffset, matrices.data(),
+        matrices.size() * sizeof(glm::mat4));
+  for (size_t i = 0; i < displays.size(); i++) {
+    write(meshes[i].vertexOffset, displays[i]->Vertices(),
+          meshes[i].vertexCount * sizeof(Vertex));
+    write(meshes[i].indexOffset, displays[i]->Indices(),
+          meshes[i].indexCount * sizeof(uint32_t));
+  }
+  if (!out) {
+    throw std::runtime_error("renderer::SceneFile: cannot write " + path);
+  }
+}
+
+std::vector<glm::mat4> SceneFile::Model::Render(const Frame &f) const {
+  return {Compose(folded, tracks, count, f)};
+}
+
+}  // namespace renderer
@@ -0,0 +1,115 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_SCENEFILE_H_
+#define SRC_RENDERER_SCENEFILE_H_
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/renderer/animation.h"
+#include "src/renderer/event/event.h"
+#include "src/renderer/renderer.h"
+
+namespace renderer {
+
+// Binary scene of meshes and their instances, laid out so a memory mapped
+// file is used in place: geometry, tracks and matrices are read straight
+// from the mapping without being parsed or copied.
+//
+// The file is a Header followed by sections at kAlign aligned offsets:
+//   meshes     MeshRecord[meshes]
+//   instances  InstanceRecord[instances]
+//   tracks     Track[tracks]
+//   matrices   glm::mat4[matrices]
+//   geometry   Vertex and uint32_t index arrays named by the mesh records
+// in the writer's native byte order; Open rejects any other.
+class SceneFile : public std::enable_shared_from_this<SceneFile> {
+ public:
+  static const uint32_t kVersion = 1;
+  static const size_t kAlign = 64;
+
+  // Map a scene file, throwing if it is not one this version can read
+  static std::shared_ptr<SceneFile> Open(const std::string &path);
+  // Write records' meshes and models, throwing if a model can't be
+  // flattened into constant matrices and tracks
+  static void Write(const std::string &path,
+                    const std::vector<event::SpawnBatch::Record> &records);
+
+  SceneFile(const SceneFile &) = delete;
+  ~SceneFile();
+
+  size_t Meshes() const { return meshes.size(); }
+  size_t Instances() const;
+  // A record spawning each instance; their geometry and models are views of
+  // the mapping which keep this file open
+  std::vector<event::SpawnBatch::Record> Records();
+
+ private:
+  struct Header {
+    char magic[8];
+    uint32_t version, meshes;
+    uint64_t instances, tracks, matrices;
+    uint64_t meshOffset, instanceOffset, trackOffset, matrixOffset;
+  };
+  struct MeshRecord {
+    uint64_t vertexOffset, vertexCount, indexOffset, indexCount;
+  };
+  // An instance's model is its track count of tracks from track and one
+  // more matrices from matrix, as a Flat
+  struct InstanceRecord {
+    uint32_t mesh, tracks;
+    uint64_t track, matrix;
+  };
+
+  class Geometry : public Rasterizable {
+   public:
+    Geometry(const Vertex *v, size_t vc, const uint32_t *i, size_t ic)
+        : vertices{v}, vertexCount{vc}, indices{i}, indexCount{ic} {}
+    const Vertex *Vertices() const override { return vertices; }
+    size_t VertexCount() const override { return vertexCount; }
+    const uint32_t *Indices() const override { return indices; }
+    size_t IndexCount() const override { return indexCount; }
+
+   private:
+    const Vertex *vertices;
+    size_t vertexCount;
+    const uint32_t *indices;
+    size_t indexCount;
+  };
+
+  class Model : public Renderable {
+   public:
+    Model(const glm::mat4 *f, const Track *t, size_t n)
+        : folded{f}, tracks{t}, count{n} {}
+    std::vector<glm::mat4> Render(const Frame &f) const override;
+    bool Flattened(FlatView *v) const override {
+      *v = {folded, tracks, count};
+      return true;
+    }
+
+   private:
+    const glm::mat4 *folded;
+    const Track *tracks;
+    size_t count;
+  };
+
+  // Validate and index a mapping of s bytes, unmapping it on destruction
+  SceneFile(const void *d, size_t s);
+  // Pointer to n Ts at offset, throwing unless they lie within the file
+  template <typename T>
+  const T *At(uint64_t offset, uint64_t n) const;
+
+  const char *data;
+  size_t size;
+  const InstanceRecord *instances;
+  std::vector<Geometry> meshes;
+  std::vector<Model> models;
+};
+
+}  // namespace renderer
+
+#endif  // SRC_RENDERER_SCENEFILE_H_
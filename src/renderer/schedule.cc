@@ -0,0 +1,86 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/renderer/schedule.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace renderer {
+
+const size_t Fps::kWindow;
+
+Fps::Fps() : ticks{std::chrono::steady_clock::now()}, diff{0}, sum{0} {}
+
+void Fps::Update(std::chrono::steady_clock::time_point now) {
+  Record(now - ticks);
+  ticks = now;
+}
+
+void Fps::Record(std::chrono::duration<double> d) {
+  diff = d;
+  auto &slot = times[count % kWindow];
+  if (count >= kWindow) {
+    sum -= slot;
+  }
+  slot = diff;
+  sum += diff;
+  count++;
+}
+
+double Fps::Frame() const { return 1.0 / diff.count(); }
+
+double Fps::Mean() const { return 1.0 / Average().count(); }
+
+std::chrono::duration<double> Fps::Average() const {
+  if (Count() == 0) {
+    return std::chrono::duration<double>{0};
+  }
+  return sum / static_cast<double>(Count());
+}
+
+std::chrono::duration<double> Fps::Percentile(double p) const {
+  if (Count() == 0) {
+    return std::chrono::duration<double>{0};
+  }
+  std::vector<std::chrono::duration<double>> sorted(times.begin(),
+                                                    times.begin() + Count());
+  auto n = std::min(Count() - 1, static_cast<size_t>(p * Count()));
+  std::nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+  return sorted[n];
+}
+
+std::ostream &operator<<(std::ostream &o, const Fps &fps) {
+  return o << fps.Frame();
+}
+
+Schedule::Schedule(Mode m, double rate)
+    : mode{m},
+      period{rate > 0 ? std::chrono::duration_cast<
+                            std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>{1 / rate})
+                      : std::chrono::steady_clock::duration{0}},
+      deadline{std::chrono::steady_clock::now()},
+      started{deadline} {}
+
+void Schedule::Wait() {
+  // Sleeping is pointless once the window shows frames' work alone taking
+  // longer than the period; they are drawn back to back instead. The
+  // presented interval includes the sleep, so it cannot tell.
+  if (period.count() != 0 &&
+      !(work.Count() == Fps::kWindow && work.Average() >= period)) {
+    std::this_thread::sleep_until(deadline);
+  }
+  started = std::chrono::steady_clock::now();
+}
+
+void Schedule::Presented() {
+  auto now = std::chrono::steady_clock::now();
+  fps.Update(now);
+  work.Record(now - started);
+  // Deadlines advance by whole periods so oversleeping does not drift the
+  // rate, but a late frame is not made up for with a burst
+  deadline = std::max(deadline + period, now);
+}
+
+}  // namespace renderer
@@ -0,0 +1,95 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RENDERER_SCHEDULE_H_
+#define SRC_RENDERER_SCHEDULE_H_
+
+#include <array>
+#include <chrono>
+#include <ostream>
+
+namespace renderer {
+
+// Rolling frame time statistics over the last kWindow frames
+class Fps {
+ public:
+  static const size_t kWindow = 128;
+
+  Fps();
+  // Record a frame ending now
+  void Update() { Update(std::chrono::steady_clock::now()); }
+  void Update(std::chrono::steady_clock::time_point now);
+  // Record a duration directly, e.g. the work of a frame
+  void Record(std::chrono::duration<double> d);
+  // Rate of the last frame
+  double Frame() const;
+  // Mean rate over the window
+  double Mean() const;
+  // Mean frame time over the window
+  std::chrono::duration<double> Average() const;
+  // Frame time which the fraction p of the window's frames took at most
+  std::chrono::duration<double> Percentile(double p) const;
+  // Frames in the window
+  size_t Count() const { return count < kWindow ? count : kWindow; }
+
+ private:
+  std::chrono::steady_clock::time_point ticks;
+  std::chrono::duration<double> diff;
+  // Ring of the window's frame times and their sum
+  std::array<std::chrono::duration<double>, kWindow> times;
+  std::chrono::duration<double> sum;
+  size_t count = 0;
+};
+
+std::ostream &operator<<(std::ostream &o, const Fps &fps);
+
+// Decides when a render thread draws its next frame
+class Schedule {
+ public:
+  enum class Mode {
+    // As fast as possible
+    kUnlimited,
+    // Once per display refresh, blocking in swap
+    kVsync,
+    // At a fixed rate, sleeping until each frame's deadline
+    kFixed,
+    // Only when the scene or its animations change, at most at a fixed rate
+    kOnChange
+  };
+
+  static Schedule Unlimited() { return Schedule{Mode::kUnlimited, 0}; }
+  static Schedule Vsync() { return Schedule{Mode::kVsync, 0}; }
+  static Schedule Fixed(double fps) { return Schedule{Mode::kFixed, fps}; }
+  static Schedule OnChange(double fps = 60) {
+    return Schedule{Mode::kOnChange, fps};
+  }
+
+  Mode Pace() const { return mode; }
+  // Swap interval surfaces present with
+  int Swapiness() const { return mode == Mode::kVsync ? 1 : 0; }
+  // Longest an unchanged scene is waited on before surfaces are polled for
+  // input again
+  std::chrono::milliseconds Idle() const {
+    return std::chrono::milliseconds{100};
+  }
+
+  // Sleep until the next frame is due
+  void Wait();
+  // Record a frame as presented
+  void Presented();
+  const Fps &Stats() const { return fps; }
+  // Time frames took from the end of Wait until presented
+  const Fps &Work() const { return work; }
+
+ private:
+  Schedule(Mode m, double rate);
+
+  Mode mode;
+  // Time between frames, or zero if unpaced
+  std::chrono::steady_clock::duration period;
+  std::chrono::steady_clock::time_point deadline, started;
+  Fps fps, work;
+};
+
+}  // namespace renderer
+
+#endif  // SRC_RENDERER_SCHEDULE_H_
@@ -0,0 +1,59 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/runloop.h"
+
+#include <memory>
+#include <utility>
+
+RunLoop::RunLoop(size_t c)
+    : capacity{c},
+      queue{[](std::pair<std::shared_ptr<Actor>, std::shared_ptr<Event>> t) {
+              t.first->Handle(t.second);
+            },
+            {64, 8, 1}} {}
+
+void RunLoop::Post(std::shared_ptr<Actor> a, std::shared_ptr<Event> e) {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    // The owner would wait on itself
+    space.wait(lock, [&] {
+      return closed || std::this_thread::get_id() == owner ||
+             queue.Pending() < capacity;
+    });
+    if (closed) {
+      return;
+    }
+  }
+  auto lane = static_cast<size_t>(e->Lane());
+  if (auto key = e->Conflation()) {
+    queue.Put({a, e}, lane, {a.get(), key});
+  } else {
+    queue.Put({a, e}, lane);
+  }
+}
+
+bool RunLoop::Drain() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    owner = std::this_thread::get_id();
+  }
+  // Only what is pending now, so posters can't keep the owner draining
+  auto ran = queue.Pull(queue.Pending()) != 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  space.notify_all();
+  return ran;
+}
+
+void RunLoop::Wait() {
+  queue.Await();
+  Drain();
+}
+
+void RunLoop::Close() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    closed = true;
+  }
+  queue.Clear();
+  space.notify_all();
+}
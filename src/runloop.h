@@ -0,0 +1,52 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_RUNLOOP_H_
+#define SRC_RUNLOOP_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "src/base.h"
+#include "src/util.h"
+
+// Executor drained by the thread which owns it in between its own work,
+// e.g. a render thread between frames, so actors with it as their affinity
+// handle events on that thread. Events wait in the loop's lanes, conflating
+// as they do in the spool's, and at most capacity of them: posting more
+// blocks until the owner drains, unless the owner itself posts.
+class RunLoop : public Executor {
+ public:
+  explicit RunLoop(size_t capacity = 1 << 16);
+  void Post(std::shared_ptr<Actor> a, std::shared_ptr<Event> e) override;
+  // Handle every event posted so far, returning whether there were any
+  bool Drain();
+  // Block until something is posted, then drain
+  void Wait();
+  // Block until something is posted or timeout passes, then drain
+  template <typename Rep, typename Period>
+  bool Wait(std::chrono::duration<Rep, Period> timeout) {
+    queue.Await(timeout);
+    return Drain();
+  }
+  // Stop handling events once the owner is done, dropping those pending
+  // and any posted later
+  void Close();
+
+ private:
+  size_t capacity;
+  std::mutex mutex;
+  std::condition_variable space;
+  bool closed = false;
+  // Thread which last drained
+  std::thread::id owner;
+  // Keyed by receiver and conflation key
+  util::ConsumerQueue<std::pair<std::shared_ptr<Actor>, std::shared_ptr<Event>>,
+                      std::pair<const Actor *, uint64_t>>
+      queue;
+};
+
+#endif  // SRC_RUNLOOP_H_
@@ -0,0 +1,117 @@
+// Copyright 2016 Connor Taffe
+
+// Checks a run loop queues a thread-affine actor's events in lanes,
+// conflates them, bounds its backlog and drops events once closed, with the
+// spool handing them over.
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/events.h"
+#include "src/runloop.h"
+#include "src/spool.h"
+
+namespace {
+
+// Event in a lane, conflating with others of the same key if it has one
+class Tagged : public Event {
+ public:
+  Tagged(int t, Priority l, uint64_t k = 0) : tag{t}, lane{l}, key{k} {}
+  std::string Description() override { return "Tagged"; }
+  Priority Lane() const override { return lane; }
+  uint64_t Conflation() const override { return key; }
+  int Tag() const { return tag; }
+
+ private:
+  int tag;
+  Priority lane;
+  uint64_t key;
+};
+
+// Records the tags it handles on the thread draining its loop
+class Affine : public Actor {
+ public:
+  explicit Affine(size_t capacity) : loop{capacity} {}
+  void Handle(std::shared_ptr<Event> e) override {
+    if (auto t = std::dynamic_pointer_cast<Tagged>(e)) {
+      tags.push_back(t->Tag());
+    }
+  }
+  Executor *Affinity() override { return &loop; }
+
+  RunLoop loop;
+  std::vector<int> tags;
+};
+
+void check(bool ok, const char *what) {
+  if (!ok) {
+    std::cerr << "runloop_test: FAIL: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+}  // namespace
+
+int main() {
+  // Posted before the loop's thread drains, so every event waits in it
+  auto a = std::make_shared<Affine>(1000);
+  std::vector<std::shared_ptr<Actor>> to{a};
+  auto s = Spool::Instance();
+  for (int i = 0; i < 10; i++) {
+    s->Handle(std::make_shared<Tagged>(i, Priority::kBulk), to);
+  }
+  for (int i = 10; i < 20; i++) {
+    s->Handle(std::make_shared<Tagged>(i, Priority::kNormal, 1), to);
+  }
+  s->Handle(std::make_shared<Tagged>(20, Priority::kControl), to);
+  a->loop.Drain();
+  // The control event first, one conflated normal event, then the bulk
+  std::vector<int> expected{20, 19, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  check(a->tags == expected, "events were not laned and conflated");
+  std::cout << "lanes: drained 12 of 21 events, in lane order" << std::endl;
+
+  // Posting past capacity waits for the loop's thread to drain
+  a->tags.clear();
+  std::atomic<bool> posted{false};
+  std::thread poster{[&] {
+    for (int i = 0; i < 2000; i++) {
+      s->Handle(std::make_shared<Tagged>(i, Priority::kNormal), to);
+    }
+    posted = true;
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  check(!posted, "posting did not wait on a full loop");
+  while (!posted) {
+    a->loop.Wait(std::chrono::milliseconds(10));
+  }
+  poster.join();
+  a->loop.Drain();
+  check(a->tags.size() == 2000, "events were lost");
+  std::cout << "bound: posting waited while 1000 events were pending"
+            << std::endl;
+
+  // Once closed, pending and later events are dropped without blocking
+  a->tags.clear();
+  for (int i = 0; i < 1000; i++) {
+    s->Handle(std::make_shared<Tagged>(i, Priority::kNormal), to);
+  }
+  a->loop.Close();
+  for (int i = 0; i < 5000; i++) {
+    s->Handle(std::make_shared<Tagged>(i, Priority::kNormal), to);
+  }
+  a->loop.Drain();
+  check(a->tags.empty(), "a closed loop handled events");
+  std::cout << "close: dropped pending and later events" << std::endl;
+  std::cout << "runloop_test: PASS" << std::endl;
+  // The spool singleton is never torn down
+  std::cout.flush();
+  _exit(0);
+}
@@ -1,16 +1,114 @@
 // Copyright 2016 Connor Taffe
 
 #include "src/spool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+
 #include "src/events.h"
 
 Spool *Spool::instance = nullptr;
 
+namespace {
+
+// Shared state of a Spool::Parallel call, outliving the call itself for
+// helpers which are dequeued after every job has been claimed. Reused by the
+// next call once no helper holds it.
+class Batch : public Event {
+ public:
+  std::string Description() override { return "Running a parallel batch"; }
+
+  void Reset(size_t j, void (*f)(void *, size_t), void *c) {
+    jobs = j;
+    func = f;
+    context = c;
+    next = 0;
+    done = 0;
+  }
+
+  // Claim and run jobs until none are left.
+  void Help() {
+    for (;;) {
+      auto i = next.fetch_add(1);
+      if (i >= jobs) {
+        return;
+      }
+      func(context, i);
+      if (done.fetch_add(1) + 1 == jobs) {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.notify_all();
+      }
+    }
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&] { return done.load() == jobs; });
+  }
+
+ private:
+  size_t jobs = 0;
+  void (*func)(void *, size_t) = nullptr;
+  void *context = nullptr;
+  std::atomic<size_t> next{0}, done{0};
+  std::mutex mutex;
+  std::condition_variable condition;
+};
+
+// Runs the Batch it is handed on whichever worker dequeues it
+class Helper : public Actor {
+ public:
+  void Handle(std::shared_ptr<Event> e) override {
+    ([&](std::shared_ptr<Batch> b) {
+      if (b != nullptr) {
+        b->Help();
+      }
+    })(std::dynamic_pointer_cast<Batch>(e));
+  }
+};
+
+}  // namespace
+
+void Spool::Parallel(size_t jobs, void (*job)(void *, size_t),
+                     void *context) {
+  if (jobs == 0) {
+    return;
+  }
+  // Batches no helper holds any longer are free; ones still in use, e.g. by
+  // a call nested in a job, are skipped
+  thread_local std::vector<std::shared_ptr<Batch>> batches;
+  std::shared_ptr<Batch> batch;
+  for (auto &b : batches) {
+    if (b.use_count() == 1) {
+      batch = b;
+      break;
+    }
+  }
+  if (batch == nullptr) {
+    batches.push_back(std::make_shared<Batch>());
+    batch = batches.back();
+  }
+  // Pairs with the last helper releasing the batch
+  std::atomic_thread_fence(std::memory_order_acquire);
+  batch->Reset(jobs, job, context);
+  // Helpers are queued for as many cores as there are, even if fewer workers
+  // are running, so a pool shrunk while idle grows back
+  auto helpers = std::min(jobs, Cores()) - 1;
+  static auto helper = std::shared_ptr<Actor>{new Helper{}};
+  for (size_t i = 0; i < helpers; i++) {
+    handles.Put({helper, batch}, static_cast<size_t>(batch->Lane()));
+  }
+  batch->Help();
+  batch->Wait();
+}
+
 void Spool::Handle(std::shared_ptr<Event> e) {
-  std::vector<std::pair<std::shared_ptr<Actor>, std::shared_ptr<Event>>> v;
-  for (auto a : actors) {
-    v.push_back({a, e});
+  if (auto j = std::atomic_load(&journal)) {
+    j->Record(*e);
   }
-  handles.Put(v);
+
+  Put(e, actors);
 
   // Terminate spool
   ([=](std::shared_ptr<events::Terminate> t) {
@@ -3,14 +3,20 @@
 #ifndef SRC_SPOOL_H_
 #define SRC_SPOOL_H_
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <mutex>
 #include <set>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "src/base.h"
+#include "src/journal.h"
 #include "src/util.h"
 
 // Event Spool singleton
@@ -29,29 +35,86 @@ class Spool : public Actor {
   // Specify receivers for an event
   void Handle(std::shared_ptr<Event> e,
               std::vector<std::shared_ptr<Actor>> ac) {
-    std::vector<std::pair<std::shared_ptr<Actor>, std::shared_ptr<Event>>> v;
-    for (auto a : ac) {
-      v.push_back({a, e});
-    }
-    handles.Put(v);
+    Put(e, ac);
+  }
+
+  // Run f(0) through f(jobs - 1) on the spool's workers and the calling
+  // thread, returning once every job has finished. The caller claims jobs
+  // alongside the workers, so this makes progress even when every worker is
+  // blocked or the spool is not running. Once warm a call allocates nothing,
+  // as f is only referred to for its duration.
+  template <typename F>
+  void Parallel(size_t jobs, F &&f) {
+    using Job = std::remove_reference_t<F>;
+    Parallel(jobs, [](void *c, size_t i) { (*static_cast<Job *>(c))(i); },
+             const_cast<void *>(static_cast<const void *>(&f)));
   }
 
-  void Run() { handles.Run(std::thread::hardware_concurrency()); }
+  // Run from one worker up to four per core, adding workers while events
+  // wait over 2ms with none idle, e.g. when handlers block, and retiring
+  // workers idle for 5s
+  void Run() {
+    handles.Run(1, 4 * Cores(), std::chrono::milliseconds(2),
+                std::chrono::seconds(5));
+  }
 
   void Wait() { handles.Wait(); }
 
+  // How the worker pool has been sized so far
+  util::Sizing Counters() { return handles.Counters(); }
+
+  // Record every event handled by registered actors into a journal, or stop
+  // recording if j is null
+  void Journal(std::shared_ptr<journal::Journal> j) {
+    std::atomic_store(&journal, j);
+  }
+
  private:
+  // While backlogged, control, normal and bulk events are dequeued 64:8:1
   Spool()
       : handles(
             [=](std::pair<std::shared_ptr<Actor>, std::shared_ptr<Event>> t) {
               t.first->Handle(t.second);
-            }) {}
+            },
+            {64, 8, 1}) {}
+  // Queue e for every actor of ac in its lane, conflating it if it has a
+  // key. Thread-affine actors' events are queued by their executor, which
+  // they wait in until its thread pulls them.
+  template <typename Actors>
+  void Put(std::shared_ptr<Event> e, const Actors &ac) {
+    auto lane = static_cast<size_t>(e->Lane());
+    auto key = e->Conflation();
+    std::vector<std::pair<std::shared_ptr<Actor>, std::shared_ptr<Event>>> v;
+    for (auto &a : ac) {
+      if (auto x = a->Affinity()) {
+        x->Post(a, e);
+      } else if (key != 0) {
+        handles.Put({a, e}, lane, {a.get(), key});
+      } else {
+        v.push_back({a, e});
+      }
+    }
+    if (!v.empty()) {
+      handles.Put(v, lane);
+    }
+  }
+
+  // Parallel over a job function and the context it is called with
+  void Parallel(size_t jobs, void (*job)(void *, size_t), void *context);
+
   Spool(Spool const &) = delete;
   Spool &operator=(Spool const &) = delete;
+  static size_t Cores() {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
   static Spool *instance;
   std::mutex actorsMtx;
   std::set<std::shared_ptr<Actor>> actors;
-  util::ConsumerQueue<std::pair<std::shared_ptr<Actor>, std::shared_ptr<Event>>>
+  std::shared_ptr<journal::Journal> journal;
+  // Keyed by receiver and conflation key
+  util::ConsumerQueue<std::pair<std::shared_ptr<Actor>, std::shared_ptr<Event>>,
+                      std::pair<const Actor *, uint64_t>>
       handles;
 };
 
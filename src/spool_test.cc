@@ -0,0 +1,157 @@
+// Copyright 2016 Connor Taffe
+
+// Counts heap allocations to check Spool::Parallel, nested calls and a
+// frame shaped like the GL renderer's allocate nothing once warm.
+
+#include <unistd.h>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#include "src/renderer/arena.h"
+#include "src/renderer/cull.h"
+#include "src/spool.h"
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+}  // namespace
+
+void *operator new(size_t n) {
+  allocations++;
+  if (auto p = std::malloc(n == 0 ? 1 : n)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+void check(bool ok, const char *what) {
+  if (!ok) {
+    std::cerr << "spool_test: FAIL: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+// Heap allocations made by f once warmed by a few runs of it, measured again
+// if the spool's pool grew meanwhile, as starting a worker allocates
+template <typename F>
+size_t warm(F f) {
+  for (int i = 0; i < 10; i++) {
+    f();
+  }
+  size_t n = 0;
+  for (int attempt = 0; attempt < 5; attempt++) {
+    auto added = Spool::Instance()->Counters().added;
+    auto before = allocations.load();
+    f();
+    n = allocations.load() - before;
+    if (Spool::Instance()->Counters().added == added) {
+      break;
+    }
+  }
+  return n;
+}
+
+// A thousand calls of 64 jobs, each capturing more than a std::function
+// would hold inline
+void parallel() {
+  std::vector<std::atomic<int>> counts(64);
+  int a = 1, b = 2, c = 3, d = 4;
+  auto n = warm([&] {
+    for (int i = 0; i < 1000; i++) {
+      Spool::Instance()->Parallel(counts.size(), [&](size_t j) {
+        counts[j] += a + b + c + d - 9;
+      });
+    }
+  });
+  for (auto &count : counts) {
+    check(count == counts[0] && count % 1000 == 0, "jobs were lost");
+  }
+  std::cout << "parallel: " << n << " allocations in 1000 calls" << std::endl;
+  check(n == 0, "a warm Parallel allocated");
+}
+
+// Calls from within jobs, which may not reuse their caller's batch
+void nested() {
+  std::atomic<size_t> ran{0};
+  auto n = warm([&] {
+    Spool::Instance()->Parallel(8, [&](size_t) {
+      Spool::Instance()->Parallel(8, [&](size_t) { ran++; });
+    });
+  });
+  check(ran % 64 == 0, "nested jobs were lost");
+  std::cout << "nested: " << n << " allocations" << std::endl;
+  check(n == 0, "a warm nested Parallel allocated");
+}
+
+// Instances' matrices prepared in jobs into arena-backed buffers, placed in
+// a grid and culled, as the GL renderer does every frame
+void frame() {
+  const size_t kInstances = 100000, kPerJob = 512;
+  const size_t kJobs = (kInstances + kPerJob - 1) / kPerJob;
+  renderer::Arena arena;
+  renderer::Grid grid{4};
+  renderer::Frustum frustum{glm::mat4(1.0)};
+  size_t visible = 0;
+  auto n = warm([&] {
+    {
+      std::pmr::vector<std::pmr::vector<glm::mat4>> jobs(kJobs, &arena);
+      Spool::Instance()->Parallel(kJobs, [&](size_t j) {
+        for (auto i = j * kPerJob; i < std::min(kInstances, (j + 1) * kPerJob);
+             i++) {
+          glm::mat4 m(1.0);
+          m[3] = glm::vec4(i % 100, i / 100 % 100, i / 10000, 1);
+          jobs[j].push_back(m);
+        }
+      });
+      grid.Resize(kInstances);
+      std::pmr::vector<std::pmr::vector<size_t>> moved(kJobs, &arena);
+      Spool::Instance()->Parallel(kJobs, [&](size_t j) {
+        for (size_t k = 0; k < jobs[j].size(); k++) {
+          auto i = j * kPerJob + k;
+          if (grid.Place(i, glm::vec3(jobs[j][k][3]))) {
+            moved[j].push_back(i);
+          }
+        }
+      });
+      for (auto &m : moved) {
+        for (auto i : m) {
+          grid.Rebin(i);
+        }
+      }
+      grid.Radius(1);
+      std::pmr::vector<size_t> culled{&arena};
+      grid.Cull(frustum, &culled);
+      visible = culled.size();
+    }
+    arena.Reset();
+  });
+  check(visible > 0, "nothing was visible");
+  std::cout << "frame: " << n << " allocations drawing " << visible << " of "
+            << kInstances << " instances" << std::endl;
+  check(n == 0, "a warm frame allocated");
+}
+
+}  // namespace
+
+int main() {
+  Spool::Instance()->Run();
+  parallel();
+  nested();
+  frame();
+  std::cout << "spool_test: PASS" << std::endl;
+  // The spool singleton is never torn down
+  std::cout.flush();
+  _exit(0);
+}
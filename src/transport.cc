@@ -0,0 +1,229 @@
+// Copyright 2016 Connor Taffe
+
+#include "src/transport.h"
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace transport {
+
+namespace {
+
+// Ring data starts after the shared header, on its own cache lines
+const size_t kData = 256;
+// Fragment header flags: more fragments follow, or skip to the ring's start
+const uint32_t kMore = 1u << 31;
+const uint32_t kWrap = ~0u;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared positions must be lock free");
+
+size_t padded(size_t n) { return (n + 7) / 8 * 8; }
+
+}  // namespace
+
+std::shared_ptr<Channel> Channel::Create(size_t capacity) {
+  static_assert(sizeof(Shared) <= kData, "shared header overlaps the ring");
+  if (capacity < 64 || (capacity & (capacity - 1)) != 0) {
+    throw std::runtime_error("transport::Channel: bad capacity");
+  }
+  auto m = memfd_create("actor-channel", 0);
+  if (m < 0 || ftruncate(m, kData + capacity) != 0) {
+    throw std::runtime_error("transport::Channel: cannot create memory");
+  }
+  auto c = std::shared_ptr<Channel>{
+      new Channel{m, eventfd(0, 0), eventfd(0, 0), capacity}};
+  c->shared->capacity = capacity;
+  return c;
+}
+
+std::shared_ptr<Channel> Channel::Open(int memory, int items, int space) {
+  // The header is mapped first to learn the ring's capacity
+  auto header = mmap(nullptr, kData, PROT_READ, MAP_SHARED, memory, 0);
+  if (header == MAP_FAILED) {
+    throw std::runtime_error("transport::Channel: cannot map memory");
+  }
+  auto capacity = static_cast<Shared *>(header)->capacity;
+  munmap(header, kData);
+  return std::shared_ptr<Channel>{new Channel{memory, items, space, capacity}};
+}
+
+Channel::Channel(int m, int i, int s, size_t capacity)
+    : memory{m}, items{i}, space{s}, mapped{kData + capacity} {
+  if (items < 0 || space < 0) {
+    throw std::runtime_error("transport::Channel: cannot create eventfds");
+  }
+  auto d = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, memory,
+                0);
+  if (d == MAP_FAILED) {
+    throw std::runtime_error("transport::Channel: cannot map memory");
+  }
+  shared = static_cast<Shared *>(d);
+  data = static_cast<char *>(d) + kData;
+}
+
+Channel::~Channel() {
+  munmap(shared, mapped);
+  close(memory);
+  close(items);
+  close(space);
+}
+
+template <typename F>
+bool Channel::Block(std::atomic<uint32_t> *waiting, int fd, F ready) {
+  while (!ready()) {
+    if (shared->closed.load()) {
+      return false;
+    }
+    // Flag before rechecking, so the other side either sees the flag and
+    // wakes us or made progress we see now
+    waiting->store(1);
+    if (ready() || shared->closed.load()) {
+      waiting->store(0);
+      continue;
+    }
+    uint64_t n;
+    if (read(fd, &n, sizeof(n)) < 0 && errno != EINTR) {
+      throw std::runtime_error("transport::Channel: cannot wait");
+    }
+    waiting->store(0);
+  }
+  return true;
+}
+
+void Channel::Wake(std::atomic<uint32_t> *waiting, int fd) {
+  if (waiting->load()) {
+    uint64_t n = 1;
+    if (write(fd, &n, sizeof(n)) < 0) {
+      throw std::runtime_error("transport::Channel: cannot wake");
+    }
+  }
+}
+
+bool Channel::Write(const std::string &m) {
+  auto capacity = shared->capacity;
+  // Fragments are at most half the ring, so one always fits after a wrap
+  auto largest = capacity / 2 - 8;
+  size_t sent = 0;
+  do {
+    auto n = std::min(largest, m.size() - sent);
+    auto need = 8 + padded(n);
+    auto head = shared->head.load(std::memory_order_relaxed);
+    auto index = head & (capacity - 1);
+    auto contiguous = capacity - index;
+    auto total = need + (contiguous < need ? contiguous : 0);
+    if (!Block(&shared->producerWaiting, space, [&] {
+          return capacity - (head - shared->tail.load()) >= total;
+        })) {
+      return false;
+    }
+    if (contiguous < need) {
+      std::memcpy(data + index, &kWrap, sizeof(kWrap));
+      head += contiguous;
+      index = 0;
+    }
+    sent += n;
+    uint32_t header = n | (sent < m.size() ? kMore : 0);
+    std::memcpy(data + index, &header, sizeof(header));
+    std::memcpy(data + index + 8, m.data() + sent - n, n);
+    shared->head.store(head + need);
+    Wake(&shared->consumerWaiting, items);
+  } while (sent < m.size());
+  return true;
+}
+
+bool Channel::Read(std::string *m) {
+  m->clear();
+  auto capacity = shared->capacity;
+  for (;;) {
+    auto tail = shared->tail.load(std::memory_order_relaxed);
+    if (!Block(&shared->consumerWaiting, items,
+               [&] { return shared->head.load() != tail; })) {
+      // Closed, though a message may have been published before that
+      if (shared->head.load() == tail) {
+        return false;
+      }
+    }
+    auto index = tail & (capacity - 1);
+    uint32_t header;
+    std::memcpy(&header, data + index, sizeof(header));
+    if (header == kWrap) {
+      tail += capacity - index;
+    } else {
+      auto n = header & ~kMore;
+      m->append(data + index + 8, n);
+      tail += 8 + padded(n);
+    }
+    shared->tail.store(tail);
+    Wake(&shared->producerWaiting, space);
+    if (header != kWrap && (header & kMore) == 0) {
+      return true;
+    }
+  }
+}
+
+void Channel::Close() {
+  shared->closed.store(1);
+  uint64_t n = 1;
+  // Either side may be blocked
+  write(items, &n, sizeof(n));
+  write(space, &n, sizeof(n));
+}
+
+void Proxy::Handle(std::shared_ptr<Event> e) {
+  auto kind = e->Kind();
+  if (kind == 0) {
+    return;
+  }
+  thread_local journal::Encoder encoder;
+  encoder.Clear();
+  encoder.Put(kind);
+  if (!e->Encode(&encoder)) {
+    return;
+  }
+  // Events sent once the endpoint has gone are dropped
+  std::unique_lock<std::mutex> lock(mutex);
+  channel->Write(encoder.Bytes());
+}
+
+Endpoint::Endpoint(std::shared_ptr<Channel> c, Actor *target)
+    : channel{c}, thread{[=] {
+        // Handles and other names come from the other process
+        auto origin = journal::NewOrigin();
+        std::string m;
+        while (channel->Read(&m)) {
+          // Messages this process can't decode are dropped rather than
+          // ending it, as they come from another process
+          std::shared_ptr<Event> e;
+          try {
+            journal::Decoder decoder{m.data(), m.size(), origin};
+            auto kind = decoder.Get<uint32_t>();
+            e = journal::Reconstruct(kind, &decoder);
+          } catch (const std::exception &ex) {
+            std::cerr << "transport::Endpoint: dropped a message: "
+                      << ex.what() << std::endl;
+            continue;
+          }
+          target->Handle(e);
+        }
+        journal::End(origin);
+      }} {}
+
+Endpoint::~Endpoint() {
+  if (thread.joinable()) {
+    channel->Close();
+    thread.join();
+  }
+}
+
+void Endpoint::Wait() { thread.join(); }
+
+}  // namespace transport
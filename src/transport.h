@@ -0,0 +1,99 @@
+// Copyright 2016 Connor Taffe
+
+#ifndef SRC_TRANSPORT_H_
+#define SRC_TRANSPORT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "src/base.h"
+#include "src/journal.h"
+
+// Forwarding of events between local processes, so actors can be spread
+// across them while Handle stays location transparent.
+namespace transport {
+
+// One-way channel between a producer and a consumer process: a lock-free
+// single producer, single consumer ring of messages in shared memory, with
+// eventfds to wake whichever side is blocked. Descriptors are inherited
+// across fork, or can be passed to another process and opened there.
+class Channel {
+ public:
+  // Channel with a ring of capacity bytes, a power of two
+  static std::shared_ptr<Channel> Create(size_t capacity = 1 << 24);
+  // Channel from the descriptors of one created by another process
+  static std::shared_ptr<Channel> Open(int memory, int items, int space);
+  Channel(const Channel &) = delete;
+  ~Channel();
+
+  // Append a message, blocking while the ring is full, or return false if
+  // the channel is closed; messages larger than the ring are sent in
+  // fragments. Only one thread may write at a time.
+  bool Write(const std::string &m);
+  // Next message, blocking until one arrives; false once closed and drained
+  bool Read(std::string *m);
+  // End the channel once drained, waking either side
+  void Close();
+
+  int Memory() const { return memory; }
+  int Items() const { return items; }
+  int Space() const { return space; }
+
+ private:
+  // Shared by both processes; positions count bytes ever written or read
+  struct Shared {
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    // Rarely written, so these share a line
+    alignas(64) uint64_t capacity;
+    std::atomic<uint32_t> consumerWaiting, producerWaiting, closed;
+  };
+
+  Channel(int m, int i, int s, size_t capacity);
+  // Block on fd until ready returns true, flagging waiting meanwhile
+  template <typename F>
+  bool Block(std::atomic<uint32_t> *waiting, int fd, F ready);
+  void Wake(std::atomic<uint32_t> *waiting, int fd);
+
+  int memory, items, space;
+  size_t mapped;
+  Shared *shared;
+  char *data;
+};
+
+// Actor forwarding journaled events to an Endpoint in another process;
+// events without an encoding are not forwarded.
+class Proxy : public Actor {
+ public:
+  explicit Proxy(std::shared_ptr<Channel> c) : channel{c} {}
+  ~Proxy() { channel->Close(); }
+  void Handle(std::shared_ptr<Event> e) override;
+
+ private:
+  std::shared_ptr<Channel> channel;
+  // Serializes writers, as the ring has a single producer
+  std::mutex mutex;
+};
+
+// Handles the events a Proxy forwards over a channel with a local actor,
+// e.g. that process' spool, on a thread of its own.
+class Endpoint {
+ public:
+  Endpoint(std::shared_ptr<Channel> c, Actor *target);
+  ~Endpoint();
+
+  // Block until the channel is closed and drained
+  void Wait();
+
+ private:
+  std::shared_ptr<Channel> channel;
+  std::thread thread;
+};
+
+}  // namespace transport
+
+#endif  // SRC_TRANSPORT_H_
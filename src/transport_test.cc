@@ -0,0 +1,99 @@
+// Copyright 2016 Connor Taffe
+
+// Forwards events from this process to a forked one over a channel and
+// checks they all arrive, in order, past messages the endpoint can't decode.
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "src/events.h"
+#include "src/journal.h"
+#include "src/transport.h"
+
+namespace {
+
+// Events sent, small enough for a ring of kCapacity to wrap many times
+const int kEvents = 100000;
+const size_t kCapacity = 4096;
+
+// Reason of the ith event; every tenth is larger than the ring, so is sent
+// in fragments
+std::string reason(int i) {
+  return i % 10 == 0 ? std::string(3 * kCapacity, 'a' + i % 26)
+                     : "event " + std::to_string(i);
+}
+
+// Counts the events it handles, checking each is the next one sent
+class Checker : public Actor {
+ public:
+  void Handle(std::shared_ptr<Event> e) override {
+    auto t = std::dynamic_pointer_cast<events::Terminate>(e);
+    if (t == nullptr ||
+        t->Description() != events::Terminate{reason(handled)}.Description()) {
+      std::cerr << "transport_test: event " << handled << " differs"
+                << std::endl;
+      std::exit(1);
+    }
+    handled++;
+  }
+  int Handled() const { return handled; }
+
+ private:
+  int handled = 0;
+};
+
+}  // namespace
+
+int main() {
+  // A dead endpoint leaves the sender blocked on a full ring, so time out
+  alarm(60);
+  auto channel = transport::Channel::Create(kCapacity);
+  auto pid = fork();
+  if (pid < 0) {
+    std::cerr << "transport_test: cannot fork" << std::endl;
+    return 1;
+  }
+  if (pid == 0) {
+    Checker checker;
+    {
+      transport::Endpoint endpoint{channel, &checker};
+      endpoint.Wait();
+    }
+    if (checker.Handled() != kEvents) {
+      std::cerr << "transport_test: " << checker.Handled() << " of "
+                << kEvents << " events arrived" << std::endl;
+      _exit(1);
+    }
+    _exit(0);
+  }
+
+  {
+    transport::Proxy proxy{channel};
+    for (int i = 0; i < kEvents; i++) {
+      proxy.Handle(std::make_shared<events::Terminate>(reason(i)));
+      if (i == kEvents / 2) {
+        // A kind with no decoder, then a truncated event
+        channel->Write(std::string(4, '\xff'));
+        journal::Encoder encoder;
+        encoder.Put(journal::Tag("events::Terminate"));
+        encoder.Put<uint64_t>(1 << 20);
+        channel->Write(encoder.Bytes());
+      }
+    }
+    // Not journaled, so not forwarded
+    proxy.Handle(std::make_shared<events::Say>(nullptr, "dropped"));
+  }
+  int status;
+  if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0) {
+    std::cerr << "transport_test: FAIL" << std::endl;
+    return 1;
+  }
+  std::cout << "transport_test: PASS" << std::endl;
+}
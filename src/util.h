@@ -3,76 +3,349 @@
 #ifndef SRC_UTIL_H_
 #define SRC_UTIL_H_
 
+#include <algorithm>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <iostream>
+#include <iterator>
+#include <list>
+#include <map>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <utility>
 #include <vector>
 
 namespace util {
 
+// Sizing decisions of a ConsumerQueue's pool
+struct Sizing {
+  // Consumer threads running, and those waiting for work
+  size_t workers = 0, idle = 0;
+  // Most running at once
+  size_t peak = 0;
+  // Started because items waited too long, and stopped after idling
+  size_t added = 0, retired = 0;
+};
+
+// FIFO of the subset of std::deque's interface ConsumerQueue uses, in a
+// circular buffer which keeps its capacity, so once grown a steady flow of
+// items allocates nothing
 template <typename T>
+class Ring {
+ public:
+  bool empty() const { return count == 0; }
+  size_t size() const { return count; }
+  T &operator[](size_t i) { return items[(head + i) & (items.size() - 1)]; }
+  T &front() { return items[head]; }
+  void push_back(T t) {
+    if (count == items.size()) {
+      Grow();
+    }
+    (*this)[count++] = std::move(t);
+  }
+  // Remove the front item, releasing what it holds
+  void pop_front() {
+    items[head] = T{};
+    head = (head + 1) & (items.size() - 1);
+    count--;
+  }
+  void clear() {
+    while (!empty()) {
+      pop_front();
+    }
+  }
+
+ private:
+  // A power of two in size, or empty
+  std::vector<T> items;
+  size_t head = 0, count = 0;
+
+  void Grow() {
+    std::vector<T> grown(std::max<size_t>(16, 2 * items.size()));
+    for (size_t i = 0; i < count; i++) {
+      grown[i] = std::move((*this)[i]);
+    }
+    items.swap(grown);
+    head = 0;
+  }
+};
+
+// Queue consumed by a pool of threads, with one FIFO lane per weight.
+// Lower lanes are dequeued first, but while several are backlogged each
+// gets a share of dequeues in proportion to its weight, so none starve.
+// Weights must be positive. Items put with a key conflate: one replaces
+// the pending item with the same key in place, so only the latest is
+// consumed. A queue which is never run is consumed by whichever thread
+// pulls from it instead.
+template <typename T, typename Key = uint64_t>
 class ConsumerQueue {
  public:
-  explicit ConsumerQueue(std::function<void(T)> c) : consumer{c} {}
+  explicit ConsumerQueue(std::function<void(T)> c,
+                         std::vector<size_t> w = {1})
+      : consumer{c},
+        weights{w},
+        credits{w},
+        lanes(w.size()),
+        popped(w.size()) {}
 
-  void Put(T t) {
+  // Put t, replacing the pending item put with key if there is one; the
+  // default key never conflates
+  void Put(T t, size_t lane = 0, Key key = Key{}) {
     std::unique_lock<std::mutex> lock(mutex);
 
-    queue.push(t);
-    condition.notify_one();
+    if (key != Key{}) {
+      auto k = keyed.find(key);
+      if (k != keyed.end()) {
+        auto &l = k->second.first;
+        lanes[l][k->second.second - popped[l]].item = t;
+        return;
+      }
+      keyed[key] = {lane, popped[lane] + lanes[lane].size()};
+    }
+    lanes[lane].push_back({t, key, std::chrono::steady_clock::now()});
+    Added(1);
   }
 
-  void Put(std::vector<T> v) {
+  void Put(std::vector<T> v, size_t lane = 0) {
     std::unique_lock<std::mutex> lock(mutex);
 
+    auto now = std::chrono::steady_clock::now();
     for (auto t : v) {
-      queue.push(t);
+      lanes[lane].push_back({t, Key{}, now});
     }
-    condition.notify_one();
+    Added(v.size());
   }
 
   void Kill() {
     std::unique_lock<std::mutex> lock(mutex);
     alive = false;           // end queue
     condition.notify_all();  // tell all consumers
+    supervise.notify_all();
   }
 
+  // Run a fixed pool of t threads
   void Run(uint t) {
+    std::unique_lock<std::mutex> lock(mutex);
+    minimum = maximum = t;
     for (auto i = 0; i < t; i++) {
-      threads.push_back(std::thread{[=] { Consume(); }});
+      Start();
+    }
+  }
+
+  // Run between min and max threads, adding one whenever the oldest pending
+  // item has waited latency with none idle, and retiring those which have
+  // idled for idle
+  void Run(size_t min, size_t max, std::chrono::steady_clock::duration latency,
+           std::chrono::steady_clock::duration idle) {
+    std::unique_lock<std::mutex> lock(mutex);
+    minimum = min;
+    maximum = max;
+    threshold = latency;
+    timeout = idle;
+    for (size_t i = 0; i < min; i++) {
+      Start();
     }
+    supervisor = std::thread{[=] { Supervise(); }};
   }
 
+  // Consume up to n pending items on the calling thread, in the order the
+  // pool would, returning how many were consumed
+  size_t Pull(size_t n) {
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t i = 0;
+    for (; i < n && pending > 0; i++) {
+      auto t = Pop();
+      lock.unlock();
+      consumer(t);
+      lock.lock();
+    }
+    return i;
+  }
+
+  // Block until an item is pending or the queue is killed
+  void Await() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&] { return pending > 0 || !alive; });
+  }
+  // Block until an item is pending, the queue is killed or timeout passes
+  template <typename Rep, typename Period>
+  void Await(std::chrono::duration<Rep, Period> timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait_for(lock, timeout, [&] { return pending > 0 || !alive; });
+  }
+
+  // Drop every pending item
+  void Clear() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (auto &l : lanes) {
+      l.clear();
+    }
+    keyed.clear();
+    pending = 0;
+  }
+
+  size_t Pending() {
+    std::unique_lock<std::mutex> lock(mutex);
+    return pending;
+  }
+
+  // Block until killed and drained, then join every thread
   void Wait() {
-    // Join worker threads
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      stopped.wait(lock, [&] { return !alive && sizing.workers == 0; });
+    }
+    if (supervisor.joinable()) {
+      supervisor.join();
+    }
     for (auto &t : threads) {
       t.join();
     }
+    threads.clear();
+    retired.clear();
+  }
+
+  Sizing Counters() {
+    std::unique_lock<std::mutex> lock(mutex);
+    return sizing;
   }
 
  private:
+  struct Entry {
+    T item;
+    Key key;
+    std::chrono::steady_clock::time_point queued;
+  };
+
   std::function<void(T)> consumer;
-  std::vector<std::thread> threads;
+  std::list<std::thread> threads;
+  // Threads which retired and have yet to be joined
+  std::vector<std::list<std::thread>::iterator> retired;
+  std::thread supervisor;
   std::mutex mutex;
-  std::condition_variable condition;
+  std::condition_variable condition, supervise, stopped;
   bool alive = true;  // set to false once terminated
-  std::queue<T> queue;
+  // Dequeues each lane may still make this round
+  std::vector<size_t> weights, credits;
+  // Items, and how many each lane has had dequeued
+  std::vector<Ring<Entry>> lanes;
+  std::vector<uint64_t> popped;
+  // Lane and position, counting dequeued items, of every pending keyed item
+  std::map<Key, std::pair<size_t, uint64_t>> keyed;
+  size_t pending = 0;
+  // Pool bounds; fixed pools never retire threads
+  size_t minimum = 0, maximum = 0;
+  std::chrono::steady_clock::duration threshold{0}, timeout{0};
+  Sizing sizing;
 
-  void Consume() {
+  // Count n new pending items, with the mutex held
+  void Added(size_t n) {
+    if (pending == 0) {
+      supervise.notify_one();
+    }
+    pending += n;
+    condition.notify_one();
+  }
+
+  // Start a consumer thread, with the mutex held
+  void Start() {
+    threads.emplace_back();
+    auto self = std::prev(threads.end());
+    *self = std::thread{[=] { Consume(self); }};
+    sizing.workers++;
+    sizing.peak = std::max(sizing.peak, sizing.workers);
+  }
+
+  // Lane to dequeue from, with the mutex held and an item pending
+  size_t Next() {
     for (;;) {
-      std::unique_lock<std::mutex> lock(mutex);
-      condition.wait(lock, [&] { return !queue.empty() || !alive; });
-      if (queue.empty()) {
+      for (size_t l = 0; l < lanes.size(); l++) {
+        if (!lanes[l].empty() && credits[l] > 0) {
+          credits[l]--;
+          return l;
+        }
+      }
+      // Every backlogged lane has had its share, so start another round
+      credits = weights;
+    }
+  }
+
+  void Consume(std::list<std::thread>::iterator self) {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      auto ready = [&] { return pending > 0 || !alive; };
+      sizing.idle++;
+      if (maximum > minimum) {
+        if (!condition.wait_for(lock, timeout, ready)) {
+          sizing.idle--;
+          if (sizing.workers > minimum) {
+            // Idled long enough to stop; joined by the supervisor
+            sizing.workers--;
+            sizing.retired++;
+            retired.push_back(self);
+            return;
+          }
+          continue;
+        }
+      } else {
+        condition.wait(lock, ready);
+      }
+      sizing.idle--;
+      if (pending == 0) {
         // Dead and no events left to process
+        if (--sizing.workers == 0) {
+          stopped.notify_all();
+        }
         return;
       }
-      auto t = queue.front();
-      queue.pop();
+      auto t = Pop();
       lock.unlock();
       consumer(t);
+      lock.lock();
+    }
+  }
+
+  // Dequeue the next item, with the mutex held and an item pending
+  T Pop() {
+    auto l = Next();
+    auto t = std::move(lanes[l].front());
+    lanes[l].pop_front();
+    popped[l]++;
+    pending--;
+    if (t.key != Key{}) {
+      keyed.erase(t.key);
+    }
+    return std::move(t.item);
+  }
+
+  // Grow the pool while items wait too long, and join retired threads
+  void Supervise() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (alive) {
+      for (auto t : retired) {
+        t->join();
+        threads.erase(t);
+      }
+      retired.clear();
+      if (pending == 0) {
+        supervise.wait(lock, [&] { return pending > 0 || !alive; });
+        continue;
+      }
+      // Waiting with no thread idle means every one is busy or blocked
+      auto oldest = std::chrono::steady_clock::time_point::max();
+      for (auto &l : lanes) {
+        if (!l.empty()) {
+          oldest = std::min(oldest, l.front().queued);
+        }
+      }
+      if (std::chrono::steady_clock::now() - oldest >= threshold &&
+          sizing.idle == 0 && sizing.workers < maximum) {
+        Start();
+        sizing.added++;
+      }
+      supervise.wait_for(lock, threshold / 2);
     }
   }
 };
@@ -0,0 +1,147 @@
+// Copyright 2016 Connor Taffe
+
+// Checks ConsumerQueue's lanes share dequeues by weight, measures how long
+// urgent items wait behind a bulk backlog, and checks an elastic pool grows
+// under blocking load and shrinks once idle.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "src/util.h"
+
+namespace {
+
+// The spool's lane weights
+const std::vector<size_t> kWeights = {64, 8, 1};
+
+void check(bool ok, const char *what) {
+  if (!ok) {
+    std::cerr << "util_test: FAIL: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+// While every lane is backlogged, each round dequeues exactly its weight
+// from each, most urgent first
+void fairness() {
+  const size_t kItems = 1000;
+  std::vector<size_t> order;
+  util::ConsumerQueue<size_t> queue{[&](size_t l) { order.push_back(l); },
+                                    kWeights};
+  for (size_t l = 0; l < kWeights.size(); l++) {
+    queue.Put(std::vector<size_t>(kItems, l), l);
+  }
+  queue.Run(1);
+  queue.Kill();
+  queue.Wait();
+  check(order.size() == kItems * kWeights.size(), "items lost");
+
+  size_t round = 64 + 8 + 1;
+  for (size_t r = 0; r < kItems / 64; r++) {
+    std::vector<size_t> counts(kWeights.size());
+    for (size_t i = r * round; i < (r + 1) * round; i++) {
+      counts[order[i]]++;
+    }
+    check(counts == kWeights, "a round's shares differ from the weights");
+  }
+  std::cout << "fairness: every backlogged round dequeued 64/8/1" << std::endl;
+}
+
+// Urgent items put every millisecond while one consumer works through a
+// bulk backlog of 10us items
+void latency() {
+  using Clock = std::chrono::steady_clock;
+  struct Item {
+    size_t lane;
+    Clock::time_point put;
+  };
+  const size_t kBacklog = 20000, kProbes = 100;
+  std::mutex mutex;
+  std::vector<double> waits;
+  size_t bulk = 0;
+  auto consume = [&](Item item) {
+    if (item.lane == 0) {
+      std::unique_lock<std::mutex> lock(mutex);
+      waits.push_back(std::chrono::duration<double, std::milli>(
+                          Clock::now() - item.put)
+                          .count());
+      return;
+    }
+    auto end = Clock::now() + std::chrono::microseconds(10);
+    while (Clock::now() < end) {
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    bulk++;
+  };
+  util::ConsumerQueue<Item> queue{consume, kWeights};
+  queue.Put(std::vector<Item>(kBacklog, Item{2, Clock::now()}), 2);
+  queue.Run(1);
+  for (size_t i = 0; i < kProbes; i++) {
+    queue.Put(Item{0, Clock::now()}, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  size_t during;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    during = bulk;
+  }
+  queue.Kill();
+  queue.Wait();
+
+  std::sort(waits.begin(), waits.end());
+  check(waits.size() == kProbes, "probes lost");
+  std::cout << "latency: behind a " << kBacklog << " item backlog, p50 "
+            << waits[kProbes / 2] << "ms, p99 " << waits[kProbes * 99 / 100]
+            << "ms; " << during << " bulk items handled meanwhile"
+            << std::endl;
+  // In one FIFO the first probe would wait out the whole 200ms backlog
+  check(waits[kProbes * 99 / 100] < 20, "urgent items waited on the backlog");
+  check(during > 0, "the bulk lane starved");
+}
+
+// Items put every 500us whose consumers block for 5ms, needing about ten
+// threads, then none
+void elastic() {
+  using Clock = std::chrono::steady_clock;
+  const size_t kMaximum = 64;
+  std::atomic<size_t> handled{0};
+  util::ConsumerQueue<int> queue{[&](int) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    handled++;
+  }};
+  queue.Run(1, kMaximum, std::chrono::milliseconds(2),
+            std::chrono::milliseconds(100));
+  auto start = Clock::now();
+  for (int i = 0; i < 1000; i++) {
+    queue.Put(i);
+    std::this_thread::sleep_until(start + std::chrono::microseconds(500 * i));
+  }
+  auto loaded = queue.Counters();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  auto idle = queue.Counters();
+  queue.Kill();
+  queue.Wait();
+
+  std::cout << "elastic: peaked at " << loaded.peak << " workers under load, "
+            << idle.workers << " left after idling, " << idle.added
+            << " added and " << idle.retired << " retired" << std::endl;
+  check(handled == 1000, "items lost");
+  check(loaded.peak >= 8 && loaded.peak <= kMaximum,
+        "the pool did not grow to the load");
+  check(idle.workers == 1, "idle workers were not retired");
+}
+
+}  // namespace
+
+int main() {
+  fairness();
+  latency();
+  elastic();
+  std::cout << "util_test: PASS" << std::endl;
+}